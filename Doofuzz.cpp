@@ -1,5 +1,7 @@
 #include "Doofuzz.h"
 
+#include <chrono>
+
 #include "IPlug_include_in_plug_src.h"
 #include "IControls.h"
 
@@ -8,6 +10,103 @@
 
 using namespace Doofuzz_Common;
 
+#ifdef DOOFUZZ_RT_AUDIT
+
+// Replacements for the global allocation functions, so that the audit catches every
+// heap allocation on the audio thread (see Doofuzz_RTAudit.h):
+
+void* operator new(size_t _size) {
+  RT_AUDIT_CHECK("operator new");
+  if (void* ptr = std::malloc(_size ? _size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t _size) {
+  return operator new(_size);
+}
+
+void operator delete(void* _ptr) noexcept {
+  if (_ptr) {
+    RT_AUDIT_CHECK("operator delete");
+  }
+  std::free(_ptr);
+}
+
+void operator delete[](void* _ptr) noexcept {
+  operator delete(_ptr);
+}
+
+void operator delete(void* _ptr, size_t) noexcept {
+  operator delete(_ptr);
+}
+
+void operator delete[](void* _ptr, size_t) noexcept {
+  operator delete(_ptr);
+}
+
+// And the over-aligned ones, which containers of alignas() types (like the per-channel
+// filter state) go through instead:
+
+void* operator new(size_t _size, std::align_val_t _alignment) {
+  RT_AUDIT_CHECK("operator new (aligned)");
+  const size_t alignment  = size_t(_alignment);
+  const size_t size       = ((_size ? _size : 1) + alignment - 1) / alignment * alignment;  // A multiple, for aligned_alloc
+#ifdef _WIN32
+  if (void* ptr = _aligned_malloc(size, alignment)) {
+#else
+  if (void* ptr = std::aligned_alloc(alignment, size)) {
+#endif
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t _size, std::align_val_t _alignment) {
+  return operator new(_size, _alignment);
+}
+
+void operator delete(void* _ptr, std::align_val_t) noexcept {
+  if (_ptr) {
+    RT_AUDIT_CHECK("operator delete (aligned)");
+  }
+#ifdef _WIN32
+  _aligned_free(_ptr);
+#else
+  std::free(_ptr);
+#endif
+}
+
+void operator delete[](void* _ptr, std::align_val_t _alignment) noexcept {
+  operator delete(_ptr, _alignment);
+}
+
+void operator delete(void* _ptr, size_t, std::align_val_t _alignment) noexcept {
+  operator delete(_ptr, _alignment);
+}
+
+void operator delete[](void* _ptr, size_t, std::align_val_t _alignment) noexcept {
+  operator delete(_ptr, _alignment);
+}
+
+#endif // DOOFUZZ_RT_AUDIT
+
+#ifdef DOOFUZZ_SHARED_CHANNEL
+
+#include <emscripten.h>
+
+// Each instance's channel, for its processor script to hand over to its controller
+// (see Doofuzz_SharedChannel.h). All processors in an AudioContext share this
+// module, so the script passes in its own instance, as createModule() returned it:
+
+extern "C" EMSCRIPTEN_KEEPALIVE uintptr_t Doofuzz_GetSharedChannel(WAM::Processor* _processor) {
+  Doofuzz* plugin = dynamic_cast<Doofuzz*>(_processor);
+  return plugin ? uintptr_t(plugin->getSharedChannel()) : 0;
+}
+
+#endif // DOOFUZZ_SHARED_CHANNEL
+
 Doofuzz::Doofuzz(const InstanceInfo& info): iplug::Plugin(info, MakeConfig(kNumParams, kNumPresets)) {
 
   for (int p = 0; p < kNumParams; p++) {
@@ -52,19 +151,13 @@ Doofuzz::Doofuzz(const InstanceInfo& info): iplug::Plugin(info, MakeConfig(kNumP
 
       // Boolean:
       case kParamActive:
-      case kParamOversampling: {
+      case kParamOversampling:
+      case kParamAutoOversampling: {
         GetParam(p)->InitBool(paramNames [p],
                               paramValues[p].def);
         break;
       }
 
-      /*case kParamOversampling: {
-        GetParam(p)->InitEnum(paramNames[p],
-                              paramValues[p].def,
-                              { NAM_OVERSAMPLING_FACTORS_VA_LIST });
-        break;
-      }*/
-
       default: {
         FAIL("Parameter missing");
         break;
@@ -74,7 +167,17 @@ Doofuzz::Doofuzz(const InstanceInfo& info): iplug::Plugin(info, MakeConfig(kNumP
 
   }
 
-  smoother.reset(this, kSmoothingTimeMs);
+  // The coefficients for common rates get designed here, so that resets (which some
+  // hosts do at every transport change) never block on designing them:
+  SharedCache<DoofuzzCoefs>::preload();
+
+#ifdef DOOFUZZ_SHARED_CHANNEL
+  m_Meters.mirrorTo(&m_SharedChannel);
+#endif
+
+  // The smoothers get set up in OnReset(), which always comes before processing; the
+  // UI is only built once the editor gets opened. That keeps construction, which
+  // hosts do for every instance in a session before anything else, cheap:
 
   mMakeGraphicsFunc = [&]() {
     return MakeGraphics(*this, PLUG_WIDTH, PLUG_HEIGHT, PLUG_FPS, GetScaleForScreen(PLUG_WIDTH, PLUG_HEIGHT));
@@ -147,6 +250,21 @@ Doofuzz::Doofuzz(const InstanceInfo& info): iplug::Plugin(info, MakeConfig(kNumP
           break;
         }
 
+        case kParamAutoOversampling: {
+          // Auto oversampling switch, with the factor in use underneath:
+          pGraphics->AttachControl(new IVToggleControl(controlCoordinates[p],
+                                                       p,
+                                                       paramLabels[p],
+                                                       DEFAULT_STYLE.WithShowLabel(false),
+                                                       "fixed",
+                                                       "auto"))->SetTooltip(paramToolTips[p]);
+          pGraphics->AttachControl(new ITextControl(controlCoordinates[p].GetVShifted(controlCoordinates[p].H()).GetFromTop(20.0f),
+                                                    ""),
+                                   kCtrlTagOSFactor);
+          m_ShownFactor = -1;  // Filled in by OnIdle()
+          break;
+        }
+
         default: {
           FAIL("Parameter missing");
           break;
@@ -155,6 +273,22 @@ Doofuzz::Doofuzz(const InstanceInfo& info): iplug::Plugin(info, MakeConfig(kNumP
 
     }
 
+    // Meters, fed from the audio thread through m_Meters (see Doofuzz_Meters.h):
+    pGraphics->AttachControl(new IVMeterControl<DoofuzzMeters::kNumTracks>(meterCoordinates[0],
+                                                                           "",
+                                                                           DEFAULT_STYLE.WithShowLabel(false)),
+                             kCtrlTagInputMeter)->SetTooltip("Input level:\nPeak and RMS");
+    pGraphics->AttachControl(new IVMeterControl<DoofuzzMeters::kNumTracks>(meterCoordinates[1],
+                                                                           "",
+                                                                           DEFAULT_STYLE.WithShowLabel(false)),
+                             kCtrlTagOutputMeter)->SetTooltip("Output level:\nPeak and RMS");
+    pGraphics->AttachControl(new IVMeterControl<1>(meterCoordinates[2],
+                                                   "",
+                                                   DEFAULT_STYLE.WithShowLabel(false),
+                                                   EDirection::Horizontal),
+                             kCtrlTagReductionMeter)->SetTooltip("Gain reduction:\nHow much the fuzz squashes the signal, up to 96 dB");
+    m_Meters.resend();
+
     updateKnobs();
 
   };
@@ -163,6 +297,10 @@ Doofuzz::Doofuzz(const InstanceInfo& info): iplug::Plugin(info, MakeConfig(kNumP
 
 void Doofuzz::OnReset() {
 
+#ifdef _DEBUG
+  const auto resetStart = std::chrono::steady_clock::now();
+#endif
+
   const double sr = GetSampleRate();
 
   // To prevent useless
@@ -171,26 +309,79 @@ void Doofuzz::OnReset() {
   //
   SetTailSize((int)(sr + 0.5));
 
+  m_NumChannels = std::clamp(std::max(NInChansConnected(), NOutChansConnected()), 1, kMaxNumChannels);
+
   smoother.reset(this,
                  kSmoothingTimeMs);
 
+  m_OSMode.store(getOversamplingMode(), std::memory_order_relaxed);
+  followOversamplingMode(true);
+  m_EnvAtBaseRate = m_EnvAtBaseRateSetting.load(std::memory_order_relaxed);
+
+  // Allocates for the channels in use the first time, and again only if the layout
+  // grows; a mono instance never carries a stereo footprint:
+  reserveStages(m_NumChannels);
   updateStages(true);
 
+  m_Meters.reset(sr);
+
+#ifdef _DEBUG
+  const double resetUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - resetStart).count();
+  DBGMSG("Doofuzz: %d channel(s), %d bytes per instance, %s kernels, reset in %.1f us\n", m_NumChannels, int(getFootprintBytes()),
+         Doofuzz_CPU::kCPULevelNames[Doofuzz_CPU::getCPULevel()], resetUs);
+#endif
+
+}
+
+DoofuzzCoefs::DoofuzzCoefs(double _sampleRate) {
+
+  m_SampleRate  = _sampleRate;
+
+  m_DCBlock     = OnePoleCoefs::highPass(_sampleRate, kDCBlockFreq);
+
+  Iir::RBJ::BandShelf scoopDesign;  // Design-time only
+  scoopDesign.setup(_sampleRate, kScoopFreq, kScoop_dB, kScoopBandwidth);
+  m_Scoop       = BiquadCoefs::fromIir(scoopDesign);
+
+  m_Stereoiser  = Stereoiser::design(_sampleRate);
+
+  for (int f = 0; f <= int(EFactor::k16x); f++) {
+    m_Envelope[f] = WaveShaperDoofuzz::designEnvelope(_sampleRate * (1 << f));
+  }
+
+}
+
+size_t Doofuzz::getFootprintBytes() const {
+
+  size_t bytes = sizeof(*this);
+
+  bytes += m_Stereoiser.capacity() * sizeof(Stereoiser);
+  bytes += m_ChannelFilters.getHeapSize();
+  bytes += (m_TileX.capacity() + m_TileY.capacity()) * sizeof(sample);
+  bytes += m_Meters.getHeapSize();
+  bytes += m_Telemetry.getHeapSize();
+
+  for (int e = 0; e < 2; e++) {
+    bytes += m_Engine[e].getHeapSize();
+  }
+
+  return bytes;
+
 }
 
 void Doofuzz::OnParamChange(int paramIdx) {
 
-  /*if (paramIdx == xkParamOversampling) {
-    m_Oversampling = EDoofuzzFactor(GetParam(paramIdx)->Value());
+  if ((paramIdx == kParamOversampling) || (paramIdx == kParamAutoOversampling)) {
 
-    if (GetUI() && m_Controls[paramIdx]) {
-      m_Controls[paramIdx]->As<IVButtonControl>()->SetValueStr(OSFactorLabels[m_Oversampling]);
-    }
+    // Not smoothed; ProcessBlock picks the new mode up and crossfades to its factor:
+    m_OSMode.store(getOversamplingMode(), std::memory_order_relaxed);
+
+  } else {
 
-  } else {*/
+    // Smoothed parameters:
+    smoother.change(paramIdx, GetParam(paramIdx)->Value());
 
-  // Smoothed parameters:
-  smoother.change(paramIdx, GetParam(paramIdx)->Value());
+  }
 
   if ((paramIdx == kParamActive) && GetUI()) {
     // Reflect in knob appearances:
@@ -199,80 +390,262 @@ void Doofuzz::OnParamChange(int paramIdx) {
 
 }
 
+void Doofuzz::OnIdle() {
+
+  // Show the factor in use, which with auto oversampling is up to the governor:
+  const int factor = m_PlayingFactor.load(std::memory_order_relaxed);
+
+  if ((factor != m_ShownFactor) && GetUI()) {
+    if (IControl* ctrl = GetUI()->GetControlWithTag(kCtrlTagOSFactor)) {
+      ctrl->As<ITextControl>()->SetStr(kFactorNames[factor]);
+      ctrl->SetDirty(false);
+      m_ShownFactor = factor;
+    }
+  }
+
+  // Always drained, so that it never fills up while the editor is closed:
+  m_Meters.transmit(*this);
+
+}
+
 void Doofuzz::ProcessBlock(sample** inputs, sample** outputs, int nFrames) {
 
+  RT_AUDIT_SCOPE;
+
+#ifdef DOOFUZZ_SHARED_CHANNEL
+  // Parameter changes the controller wrote since the last block:
+  m_SharedChannel.readParams([this](int param, double value) {
+    if ((param >= 0) && (param < kNumParams)) {
+      GetParam(param)->SetNormalized(value);
+      OnParamChange(param);
+    }
+  });
+#endif
+
+  followOversamplingMode(false);
+  m_EnvAtBaseRate = m_EnvAtBaseRateSetting.load(std::memory_order_relaxed);
+
+  // Auto oversampling and telemetry measure the time this block takes:
+  const bool governing  = (m_FollowedOSMode == kOSModeAuto);
+  const bool timing     = governing || m_Telemetry.isEnabled();
+  const auto blockStart = timing ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
   const int     nInChans  = std::min(kMaxNumChannels, NInChansConnected());
   const int     nOutChans = std::min(kMaxNumChannels, NOutChansConnected());
   const int     nMaxChans = std::max(nInChans, nOutChans);
 
-  for (int s = 0; s < nFrames; s++) {
+  assert((nInChans == 1) || (nInChans == nOutChans));  // "1-n" or "n-n"; can't have a "2-1" situation
 
-    updateStages(false);
+  if (nMaxChans != m_NumChannels) {
+    // Channel layout changed without a reset; bring the newly used channels up to date:
+    m_NumChannels = nMaxChans;
+    updateStages(true);
+  }
 
-    if (m_Active == 0.0) {
+  // The run kernels, specialised per channel layout and per state. The layout is
+  // picked here, once per block; the state per run of frames:
 
-      for (int ch = 0; ch < nMaxChans; ch++) {
-        outputs[std::min(ch, nOutChans-1)][s] = inputs[std::min(ch, nInChans-1)][s];
+  static constexpr RunFunc kRunFuncs[kNumLayouts][kNumRunStates] = {
+    { &Doofuzz::processRun<0, 0, kRunBypassed>, &Doofuzz::processRun<0, 0, kRunActive>, &Doofuzz::processRun<0, 0, kRunTransitioning> },  // Any
+    { &Doofuzz::processRun<1, 1, kRunBypassed>, &Doofuzz::processRun<1, 1, kRunActive>, &Doofuzz::processRun<1, 1, kRunTransitioning> },  // "1-1"
+    { &Doofuzz::processRun<1, 2, kRunBypassed>, &Doofuzz::processRun<1, 2, kRunActive>, &Doofuzz::processRun<1, 2, kRunTransitioning> },  // "1-2"
+    { &Doofuzz::processRun<2, 2, kRunBypassed>, &Doofuzz::processRun<2, 2, kRunActive>, &Doofuzz::processRun<2, 2, kRunTransitioning> },  // "2-2"
+  };
+
+  ELayout layout = kLayoutAny;
+  if      ((nInChans == 1) && (nOutChans == 1)) { layout = kLayout1to1; }
+  else if ((nInChans == 1) && (nOutChans == 2)) { layout = kLayout1to2; }
+  else if ((nInChans == 2) && (nOutChans == 2)) { layout = kLayout2to2; }
+
+  const RunFunc* runFuncs = kRunFuncs[layout];
+
+  const double inputPeak = m_Meters.addInput(inputs, nInChans, nFrames);
+
+  // Tile by tile, each stage running over the whole tile before the next one starts,
+  // so that the working set is the same whatever the host's block size:
+
+  for (int tile = 0; tile < nFrames; tile += kTileSize) {
+
+    const int nTileFrames = std::min(kTileSize, nFrames - tile);
+
+    // A new oversampling factor or envelope mode only gets picked up at the start of a
+    // tile, once any previous crossfade has finished:
+    const ShaperEngine<kMaxNumChannels>& playing = m_Engine[m_CurrentEngine];
+    if (((playing.getFactor() != m_Oversampling) || (playing.getEnvelopeAtBaseRate() != m_EnvAtBaseRate)) && (m_FadeStepsLeft == 0)) {
+      AdjustOversampling();
+    }
+
+    m_TileFadeEnd = 0;
+
+    // Smoothed parameters, frame by frame:
+    for (int f = 0; f < nTileFrames; f++) {
+
+      updateStages(false);
+
+      TileFrame& frame = m_Tile[f];
+
+      frame.m_Width       = m_Width;
+      frame.m_Drive_Real  = m_Drive_Real;
+      frame.m_Active      = m_Active;
+      frame.m_PostCoefs   = m_PostCoefs;
+      frame.m_Fade        = 1.0;
+      m_TileRip[f]        = m_Rip;
+
+      // The crossfade only advances while active:
+      if ((m_FadeStepsLeft > 0) && (m_Active != 0.0)) {
+        frame.m_Fade  = 1.0 - double(--m_FadeStepsLeft) / double(m_FadeSteps);
+        m_TileFadeEnd = f + 1;
       }
 
-    } else {
+    }
 
-      // Active: //////////////////////////////////////////////////////////////
+    // Then the tile, in runs of frames in the same state:
 
-      sample x[kMaxNumChannels];  // Scratch area
+    for (int from = 0, to; from < nTileFrames; from = to) {
 
-      // Stereoise first:
+      const ERunState state = getRunState(m_Tile[from].m_Active);
 
-      if (nInChans == kMaxNumChannels) {
+      for (to = from + 1; (to < nTileFrames) && (getRunState(m_Tile[to].m_Active) == state); to++) {}
 
-        assert(nOutChans == kMaxNumChannels);   // Can't have a "2-1" situation, so this MUST be "2-2"
-        m_Stereoiser.processFrame(inputs[0][s], inputs[1][s], &x[0], &x[1]);
+      (this->*runFuncs[state])(inputs, outputs, nInChans, nOutChans, tile, from, to);
 
-      } else {
+    }
+  }
 
-        m_Stereoiser.processFrame(inputs[0][s], inputs[0][s], &x[0], &x[1]);
+  m_Meters.addOutput(outputs, nOutChans, nFrames, 1.0 + m_Active * (m_Drive_Real * m_Output_Real - 1.0));
 
+  if (timing) {
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - blockStart).count();
+
+    if (m_Telemetry.isEnabled()) {
+      m_Telemetry.recordBlock(seconds, nFrames, GetSampleRate(), m_NumChannels, m_Engine[m_CurrentEngine].getFactor(), inputPeak);
+    }
+
+    if (governing) {
+      governOversampling(seconds,
+                         nFrames);
+    }
+  }
+}
+
+// Frames _from up to _to of the tile starting at host frame _tile. With InChans and
+// OutChans both 0, the channel counts come from _nInChans and _nOutChans; otherwise
+// they, and all channel indexing, are known at compile time:
+template<int InChans, int OutChans, Doofuzz::ERunState State>
+void Doofuzz::processRun(sample** _inputs,
+                         sample** _outputs,
+                         int      _nInChans,
+                         int      _nOutChans,
+                         int      _tile,
+                         int      _from,
+                         int      _to) {
+
+  const int     nInChans  = (InChans  > 0) ? InChans  : _nInChans;
+  const int     nOutChans = (OutChans > 0) ? OutChans : _nOutChans;
+  const int     nMaxChans = std::max(nInChans, nOutChans);
+
+  if constexpr (State == kRunBypassed) {
+
+    for (int f = _from; f < _to; f++) {
+      const int s = _tile + f;
+      for (int ch = 0; ch < nMaxChans; ch++) {
+        _outputs[std::min(ch, nOutChans-1)][s] = _inputs[std::min(ch, nInChans-1)][s];
       }
+    }
+
+    return;
 
-      ///////////////////////////////////////////////////////////////////////////
+  }
+
+  // Active or transitioning: ///////////////////////////////////////////////////
+
+  sample* const x = m_TileX.data();
+  sample* const y = m_TileY.data();
+
+  // The linear filters run all channels of a frame as lanes:
+  constexpr int kLanes = ((InChans > 0) && (OutChans > 0)) ? std::max(InChans, OutChans) : 0;
+
+  for (int f = _from; f < _to; f++) {
+
+    const int s = _tile + f;
+
+    sample in[kMaxNumChannels];  // Scratch area
 
+    // Mono input feeds both sides of the stereoiser, and all outputs ("1-2"):
+    for (int ch = 0; ch < std::max(nMaxChans, 2); ch++) {
+      in[ch] = _inputs[std::min(ch, nInChans-1)][s];
+    }
+
+    // Stereoise first, pair by pair:
+
+    for (int pair = 0; kStereoPairs[nMaxChans][pair][0] >= 0; pair++) {
+
+      const int l = kStereoPairs[nMaxChans][pair][0];
+      const int r = kStereoPairs[nMaxChans][pair][1];
+
+      m_Stereoiser[pair].setWidth(m_Tile[f].m_Width);
+      m_Stereoiser[pair].processFrame(in[l], in[r], &in[l], &in[r]);
+
+    }
+
+    std::copy(in, in + nMaxChans, x + f * nMaxChans);
+
+  }
+
+  sample* const  xRun    = x + _from * nMaxChans;
+  sample* const  yRun    = y + _from * nMaxChans;
+  const int      nRun    = _to - _from;
+  const int      nFade   = std::clamp(m_TileFadeEnd - _from, 0, nRun);
+
+  // DC block the stereoised signal, and drive it:
+  m_ChannelFilters.processInput<kLanes>(m_Coefs->m_DCBlock, m_Tile + _from, xRun, nRun);
+
+  // Oversample and shape, all channels and frames in one go. While switching
+  // oversampling factors, both engines run, and the new one gets faded in:
+
+  std::copy(xRun, xRun + nFade * nMaxChans, yRun);
+
+  m_Engine[m_CurrentEngine].process(xRun, m_TileRip + _from, nRun);  // Incoming, or the only one
+
+  if (nFade > 0) {
+
+    m_Engine[1 - m_CurrentEngine].process(yRun, m_TileRip + _from, nFade);  // Outgoing
+
+    for (int f = _from; f < _from + nFade; f++) {
+      const double fade = m_Tile[f].m_Fade;
       for (int ch = 0; ch < nMaxChans; ch++) {
+        x[f * nMaxChans + ch] = y[f * nMaxChans + ch] + fade * (x[f * nMaxChans + ch] - y[f * nMaxChans + ch]);
+      }
+    }
 
-        x[ch] =
-          m_Output_Real *
-            -m_DCBlockAfter[ch].filter( // Minus, because this filter erroneously inverts polarity.
-                                        // I reported this bug, but the developer denied there was a problem.
-              m_HighCut[ch].filter(
-                m_Scoop[ch].filter(
-
-                  m_Oversampler[ch].Process(
-                    m_Drive_Real *
-                      -m_DCBlockBefore[ch].filter(  // Minus, because this filter erroneously inverts polarity.
-                                                    // I reported this bug, but the developer denied there was a problem.
-                        x[ch]), // Use earlier stereoised values
-                    [&](sample input) {
-                      return m_Waveshaper[ch].processAudioSample(input);
-                    }
-                  )
-                )
-              )
-            );
-
-        if (m_Active != 1.0) {
-
-          // Transition: ////////////////////////////////////////////////////
-
-          x[ch] =
-            ((1.0 - m_Active) * inputs[std::min(ch, nInChans-1)][s]) +
-            ((m_Active)       * x[ch]);
+  }
 
-        }
+  // Scoop, HighCut, DCBlockAfter and Output in one go:
+  m_ChannelFilters.processOutput<kLanes>(m_Tile + _from, xRun, nRun);
+
+  for (int f = _from; f < _to; f++) {
+
+    const int s = _tile + f;
+
+    for (int ch = 0; ch < nMaxChans; ch++) {
+
+      sample out = x[f * nMaxChans + ch];
+
+      if constexpr (State == kRunTransitioning) {
+
+        const double active = m_Tile[f].m_Active;
 
-        outputs[std::min(ch, nOutChans-1)][s] = x[ch];
+        out =
+          ((1.0 - active) * _inputs[std::min(ch, nInChans-1)][s]) +
+          ((active)       * out);
 
       }
 
+      _outputs[std::min(ch, nOutChans-1)][s] = out;
+
     }
+
   }
 }
 
@@ -294,22 +667,120 @@ void Doofuzz::updateKnobs() {
   }
 }
 
+// The mode the two oversampling switches select:
+inline int Doofuzz::getOversamplingMode() {
+
+  if (GetParam(kParamOversampling)->Value() < 0.5) {
+    return kOSModeNone;
+  }
+
+  return (GetParam(kParamAutoOversampling)->Value() >= 0.5) ? kOSModeAuto : kOSMode16x;
+
+}
+
+// Starts a crossfade from the current engine to the idle one, set to the new factor and
+// envelope mode. Both were allocated at reset (including the base rate envelope
+// buffers), so this neither allocates nor touches the playing engine.
 inline void Doofuzz::AdjustOversampling() {
-  for (int ch = 0; ch < kMaxNumChannels; ch++) {
 
-    if (m_Oversampling >= 0.5) {
-      m_Oversampler[ch].SetOverSampling(EFactor::k16x);
-    } else {
-      m_Oversampler[ch].SetOverSampling(EFactor::kNone);
-    }
+  m_CurrentEngine = 1 - m_CurrentEngine;
+  m_Engine[m_CurrentEngine].setEnvelopeAtBaseRate(m_EnvAtBaseRate);
+  m_Engine[m_CurrentEngine].setOverSampling(*m_Coefs, m_Oversampling);
+  m_PlayingFactor.store(int(m_Oversampling), std::memory_order_relaxed);
+
+  m_FadeStepsLeft = m_FadeSteps;
+
+}
+
+// Auto oversampling: steps the factor down while this instance takes too much of the
+// time budget of its blocks, and back up once it has been light for a while. The
+// steps themselves are crossfaded by ProcessBlock, like any other change of factor:
+inline void Doofuzz::governOversampling(double _seconds,
+                                        int    _nFrames) {
+
+  // An empty block has no budget to measure against:
+  if (_nFrames <= 0) {
+    return;
+  }
+
+  const double sr     = GetSampleRate();
+  const double budget = double(_nFrames) / sr;
+
+  // A crossfade runs both engines, which says little about either factor:
+  if ((m_FadeStepsLeft > 0) || (m_Engine[m_CurrentEngine].getFactor() != m_Oversampling)) {
+    return;
+  }
+
+  const double averaging = 1.0 - std::exp(-budget * 1000.0 / kAutoOSLoadTimeMs);
+  m_AutoOSLoad += averaging * ((_seconds / budget) - m_AutoOSLoad);
+
+  m_AutoOSHoldFrames = std::max(0, m_AutoOSHoldFrames - _nFrames);
 
-    /*m_Oversampler[ch][0].SetOverSampling(EFactor(std::min(int(m_Oversampling),
-                                                          int(EFactor::k16x))));
-    m_Oversampler[ch][1].SetOverSampling(EFactor(std::max(int(m_Oversampling) - int(EFactor::k16x),
-                                                          int(EFactor::kNone))));*/
+  if ((m_AutoOSLoad > kAutoOSLoadHigh) && (m_AutoFactor > kAutoOSMinFactor)) {
+
+    m_AutoFactor        = EFactor(int(m_AutoFactor) - 1);
+    m_AutoOSLoad       *= 0.5;  // Expected at half the rate
+    m_AutoOSHoldFrames  = int(sr * kAutoOSHoldMs / 1000.0);
+
+  } else if ((m_AutoOSLoad < kAutoOSLoadLow) && (m_AutoFactor < EFactor::k16x) && (m_AutoOSHoldFrames == 0)) {
+
+    m_AutoFactor        = EFactor(int(m_AutoFactor) + 1);
+    m_AutoOSLoad       *= 2.0;
+    m_AutoOSHoldFrames  = int(sr * kAutoOSHoldMs / 1000.0);
+
+  }
+}
+
+// The factor to play, on the audio thread: the one the user chose, or in auto mode
+// the governor's. Only this thread changes m_Oversampling, so that a mode change
+// from the UI can't be undone by the governor stepping in the same block. Auto
+// starts at 16x:
+inline void Doofuzz::followOversamplingMode(bool _resetting) {
+
+  const int mode = m_OSMode.load(std::memory_order_relaxed);
+
+  if ((mode == kOSModeAuto) && (_resetting || (m_FollowedOSMode != kOSModeAuto))) {
+    m_AutoFactor        = EFactor::k16x;
+    m_AutoOSLoad        = 0.0;
+    m_AutoOSHoldFrames  = 0;
+  }
+
+  m_FollowedOSMode = mode;
+
+  switch (mode) {
+    case kOSModeNone: m_Oversampling = EFactor::kNone; break;
+    case kOSModeAuto: m_Oversampling = m_AutoFactor;   break;
+    default:          m_Oversampling = EFactor::k16x;  break;
   }
 }
 
+// Combines Scoop, HighCut, DCBlockAfter and Output into two second-order sections:
+inline void Doofuzz::updatePostFilter() {
+
+  m_PostCoefs.section[0] = m_Coefs->m_Scoop;
+  m_PostCoefs.section[1] = BiquadCoefs::fromFirstOrders(m_HighCutCoefs, m_Coefs->m_DCBlock).scale(m_Output_Real);
+
+}
+
+// Allocates for up to _numChannels, and for a full tile at the highest factor:
+inline void Doofuzz::reserveStages(int _numChannels) {
+
+  int numPairs = 0;
+  while (kStereoPairs[_numChannels][numPairs][0] >= 0) {
+    numPairs++;
+  }
+
+  m_Stereoiser.reserve(numPairs);
+  m_ChannelFilters.reserve(_numChannels);
+  m_TileX     .reserve(size_t(kTileSize) * _numChannels);
+  m_TileY     .reserve(size_t(kTileSize) * _numChannels);
+
+  for (int e = 0; e < 2; e++) {
+    m_Engine[e].reserve(kTileSize, _numChannels);
+  }
+
+}
+
 inline void Doofuzz::updateStages(bool _resetting) {
 
   const double sr = GetSampleRate();
@@ -317,26 +788,42 @@ inline void Doofuzz::updateStages(bool _resetting) {
   // Non-parameter-related stages:
   if (_resetting) {
 
-    m_Stereoiser.reset(sr);
-    m_Stereoiser.setWidth(m_Width);
-
-    for (int ch = 0; ch < kMaxNumChannels; ch++) {
+    // Shared with all instances at this rate; only looked up when the rate changed,
+    // so never from ProcessBlock. Without a lock or allocation for common rates:
+    if (!m_Coefs || (m_Coefs->m_SampleRate != sr)) {
+      m_Coefs = SharedCache<DoofuzzCoefs>::get(sr);
+    }
 
-      m_DCBlockBefore[ch].setup(sr, kDCBlockFreq);
+    // Size for the channels in use. This only allocates for more channels than
+    // OnReset() reserved for, which can happen from ProcessBlock if a host changes
+    // the channel layout without resetting us first:
 
-      m_Oversampler[ch].Reset(GetBlockSize());
+    int numPairs = 0;
+    while (kStereoPairs[m_NumChannels][numPairs][0] >= 0) {
+      numPairs++;
+    }
 
-      m_Waveshaper[ch].reset(sr * m_Oversampler[ch].GetRate());
-      // m_Waveshaper[ch].setEnvCutOffFreq(kEnvCutoff);
-      m_Waveshaper[ch].setRip(m_Rip);
+    m_Stereoiser.resize(numPairs);
+    m_ChannelFilters.reset(m_NumChannels);
+    m_TileX     .resize(size_t(kTileSize) * m_NumChannels);
+    m_TileY     .resize(size_t(kTileSize) * m_NumChannels);
 
-      m_Scoop[ch].setup(sr, kScoopFreq, kScoop_dB, kScoopBandwidth);
+    for (int pair = 0; pair < numPairs; pair++) {
+      m_Stereoiser[pair].reset(m_Coefs->m_Stereoiser);
+      m_Stereoiser[pair].setWidth(m_Width);
+    }
 
-      m_HighCut[ch].setup(sr, m_Tone);
+    // Both engines get their buffers now; the idle one is set up when it's needed:
+    for (int e = 0; e < 2; e++) {
+      m_Engine[e].setEnvelopeAtBaseRate(m_EnvAtBaseRate);
+      m_Engine[e].reset(*m_Coefs, kTileSize, m_NumChannels, m_Oversampling);
+    }
+    m_PlayingFactor.store(int(m_Oversampling), std::memory_order_relaxed);
 
-      m_DCBlockAfter [ch].setup(sr, kDCBlockFreq);
+    m_FadeSteps     = std::max(1, int(sr * kOSFadeTimeMs / 1000.0));
+    m_FadeStepsLeft = 0;
 
-    }
+    m_HighCutCoefs = OnePoleCoefs::lowPass(sr, m_Tone);
   }
 
   // Parameter-related stages:
@@ -347,7 +834,7 @@ inline void Doofuzz::updateStages(bool _resetting) {
       case kParamWidth: {
         double v;
         if (smoother.get(p, v) || _resetting) {
-          m_Stereoiser.setWidth(m_Width = v);
+          m_Width = v;  // Handed to the stereoisers per frame, by ProcessBlock
         }
         break;
       }
@@ -363,10 +850,7 @@ inline void Doofuzz::updateStages(bool _resetting) {
       case kParamRip: {
         double v;
         if (smoother.get(p, v) || _resetting) {
-          m_Rip = v;
-          for (int ch = 0; ch < kMaxNumChannels; ch++) {
-            m_Waveshaper[ch].setRip(v);
-          }
+          m_Rip = v;  // Handed to the engines per frame, by ProcessBlock
         }
         break;
       }
@@ -375,9 +859,8 @@ inline void Doofuzz::updateStages(bool _resetting) {
         double v;
         if (smoother.get(p, v) || _resetting) {
           m_Tone = v;
-          for (int ch = 0; ch < kMaxNumChannels; ch++) {
-            m_HighCut[ch].setup(sr, v);
-          }
+          m_HighCutCoefs = OnePoleCoefs::lowPass(sr, v);
+          updatePostFilter();
         }
         break;
       }
@@ -416,6 +899,7 @@ inline void Doofuzz::updateStages(bool _resetting) {
         double v;
         if (smoother.get(p, v) || _resetting) {
           m_Output_Real = DBToAmp(v);
+          updatePostFilter();
         }
         break;
       }
@@ -428,17 +912,13 @@ inline void Doofuzz::updateStages(bool _resetting) {
         break;
       }
 
-      case kParamOversampling: {
-        double v;
-        if (smoother.get(p, v) || _resetting) {
-          m_Oversampling = v;
-          AdjustOversampling();
-
-          for (int ch = 0; ch < kMaxNumChannels; ch++) {
-            m_Waveshaper[ch].reset(sr * m_Oversampler[ch].GetRate());
-          }
+      case kParamAutoOversampling: {
+        // Picked up by ProcessBlock, like kParamOversampling:
+        break;
+      }
 
-        }
+      case kParamOversampling: {
+        // Picked up by ProcessBlock, at the start of a tile:
         break;
         //if (m_Oversampling != m_PrevOversampling) {
         //  m_PrevOversampling = m_Oversampling;
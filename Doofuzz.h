@@ -4,19 +4,46 @@
 // - Web link
 // - mono / stereo / simulated stereo?
 
+#include <atomic>
 #include "IPlug_include_in_plug_hdr.h"
 #include "iir1/Iir.h"
-#include "Oversampler.h"
+#include "Doofuzz_OverSampler.h"
 #include "Doofuzz_ParamSmoother.h"
 #include "Doofuzz_WaveShaper.h"
+#include "Doofuzz_Filters.h"
+#include "Doofuzz_ShaperEngine.h"
+#include "Doofuzz_SharedCache.h"
+#include "Doofuzz_Meters.h"
+#include "Doofuzz_Telemetry.h"
+#include "Doofuzz_RTAudit.h"
 #include <Doofuzz_Stereoiser.h>
 
 using namespace iplug;
 using namespace igraphics;
 
 const int     kNumPresets       = 1;
-const int     kMaxNumChannels   = 2;
+const int     kMaxNumChannels   = 12;   // Up to 7.1.4
+const int     kMaxNumStereoPairs =   5;
 const double  kSmoothingTimeMs  = 20.0; // Parameter smoothing in milliseconds
+const double  kOSFadeTimeMs     = 20.0; // Crossfade between oversampling factors, in milliseconds
+const int     kTileSize         =   32; // ProcessBlock works in tiles of at most this many frames, and
+                                        // all scratch buffers are sized for a tile, not for the host's
+                                        // block size; at 16x a stereo tile stays well inside L1
+const bool    kEnvAtBaseRate    = false; // Rip envelope at base rate instead of the oversampled rate,
+                                         // by default (see setEnvelopeAtBaseRate()): 60 fewer filter
+                                         // updates per channel per sample at 16x, but a slightly
+                                         // different sound (very bright input makes the envelope
+                                         // alias a little)
+
+// Auto oversampling: each instance measures how much of a block's time budget its
+// ProcessBlock takes, averaged over kAutoOSLoadTimeMs. Above kAutoOSLoadHigh the factor
+// steps down (16x, 8x, 4x); below kAutoOSLoadLow for at least kAutoOSHoldMs, back up.
+// The gap between the two leaves room for the doubled load after a step up:
+const double  kAutoOSLoadHigh   =    0.5;
+const double  kAutoOSLoadLow    =    0.15;
+const double  kAutoOSLoadTimeMs =  200.0;
+const double  kAutoOSHoldMs     = 2000.0;
+const EFactor kAutoOSMinFactor  = EFactor::k4x;
 
 const double  kDCBlockFreq      =    40.0;
 const double  kScoopFreq        =   432.0; // Joke...
@@ -25,6 +52,46 @@ const double  kScoopBandwidth   =     2.4;
 
 //const double  kEnvCutoff        =  4320.0;
 
+// Channel pairs that get stereoised, per channel count. Centre and LFE are left
+// alone (but still get fuzzed). { -1, -1 } terminates a list. The channel order
+// differs between the APIs: Pro Tools delivers its surround stems in film order,
+// L C R Ls Rs LFE (7.1: L C R Lss Rss Lsr Rsr LFE [Ltf Rtf Ltr Rtr]), unmapped;
+// the others deliver L R C LFE Ls Rs [Lrs Rrs] [Ltf Rtf Ltr Rtr]. Odd counts from 5
+// up are the same layouts without LFE (5.0, 7.0, 7.0.2, 7.0.4).
+#ifdef AAX_API
+const int     kStereoPairs[kMaxNumChannels + 1][kMaxNumStereoPairs + 1][2] = {
+  /*  0 */ { { -1, -1 } },
+  /*  1 */ { {  0,  1 }, { -1, -1 } },                                                  // Mono: fed twice, right side discarded
+  /*  2 */ { {  0,  1 }, { -1, -1 } },
+  /*  3 */ { {  0,  2 }, { -1, -1 } },                                                  // LCR
+  /*  4 */ { {  0,  2 }, { -1, -1 } },
+  /*  5 */ { {  0,  2 }, {  3,  4 }, { -1, -1 } },                                      // 5.0
+  /*  6 */ { {  0,  2 }, {  3,  4 }, { -1, -1 } },                                      // 5.1
+  /*  7 */ { {  0,  2 }, {  3,  4 }, {  5,  6 }, { -1, -1 } },                          // 7.0
+  /*  8 */ { {  0,  2 }, {  3,  4 }, {  5,  6 }, { -1, -1 } },                          // 7.1
+  /*  9 */ { {  0,  2 }, {  3,  4 }, {  5,  6 }, {  7,  8 }, { -1, -1 } },              // 7.0.2
+  /* 10 */ { {  0,  2 }, {  3,  4 }, {  5,  6 }, {  8,  9 }, { -1, -1 } },              // 7.1.2
+  /* 11 */ { {  0,  2 }, {  3,  4 }, {  5,  6 }, {  7,  8 }, {  9, 10 }, { -1, -1 } },  // 7.0.4
+  /* 12 */ { {  0,  2 }, {  3,  4 }, {  5,  6 }, {  8,  9 }, { 10, 11 }, { -1, -1 } },  // 7.1.4
+};
+#else
+const int     kStereoPairs[kMaxNumChannels + 1][kMaxNumStereoPairs + 1][2] = {
+  /*  0 */ { { -1, -1 } },
+  /*  1 */ { {  0,  1 }, { -1, -1 } },                                                  // Mono: fed twice, right side discarded
+  /*  2 */ { {  0,  1 }, { -1, -1 } },
+  /*  3 */ { {  0,  1 }, { -1, -1 } },
+  /*  4 */ { {  0,  1 }, { -1, -1 } },
+  /*  5 */ { {  0,  1 }, {  3,  4 }, { -1, -1 } },                                      // 5.0
+  /*  6 */ { {  0,  1 }, {  4,  5 }, { -1, -1 } },                                      // 5.1
+  /*  7 */ { {  0,  1 }, {  3,  4 }, {  5,  6 }, { -1, -1 } },                          // 7.0
+  /*  8 */ { {  0,  1 }, {  4,  5 }, {  6,  7 }, { -1, -1 } },                          // 7.1
+  /*  9 */ { {  0,  1 }, {  3,  4 }, {  5,  6 }, {  7,  8 }, { -1, -1 } },              // 7.0.2
+  /* 10 */ { {  0,  1 }, {  4,  5 }, {  6,  7 }, {  8,  9 }, { -1, -1 } },              // 7.1.2
+  /* 11 */ { {  0,  1 }, {  3,  4 }, {  5,  6 }, {  7,  8 }, {  9, 10 }, { -1, -1 } },  // 7.0.4
+  /* 12 */ { {  0,  1 }, {  4,  5 }, {  6,  7 }, {  8,  9 }, { 10, 11 }, { -1, -1 } },  // 7.1.4
+};
+#endif
+
 enum EParams {
   // Main parameters (the big knobs):
   kParamWidth = 0,
@@ -34,10 +101,32 @@ enum EParams {
   kParamOutput,
   kParamActive,
   kParamOversampling,
+  kParamAutoOversampling,
   ///////////////////
   kNumParams
 };
 
+// What the two oversampling switches select between: off is none, whatever auto
+// is set to; on is 16x, or with auto, whatever factor the governor picks. Auto is
+// a parameter of its own, so that the on/off switch keeps the values (real and
+// normalised) that sessions and host automation have saved:
+enum EOversamplingModes {
+  kOSModeNone = 0,
+  kOSMode16x,
+  kOSModeAuto,
+  ////////////
+  kNumOSModes
+};
+
+enum ECtrlTags {
+  kCtrlTagOSFactor = 0,  // Shows the factor in use
+  kCtrlTagInputMeter,
+  kCtrlTagOutputMeter,
+  kCtrlTagReductionMeter,
+};
+
+const char* const kFactorNames[int(EFactor::kNumFactors)] = { "1x", "2x", "4x", "8x", "16x" };
+
 char* paramNames[kNumParams] = {
   "Width",
   "Drive",
@@ -46,6 +135,7 @@ char* paramNames[kNumParams] = {
   "Output",
   "Active",
   "Oversampling",
+  "Auto oversampling",
 };
 
 char* paramLabels[kNumParams] = {
@@ -56,6 +146,7 @@ char* paramLabels[kNumParams] = {
   "Output",
   "Active",
   "OS",
+  "Auto",
 };
 
 char* paramToolTips[kNumParams] = {
@@ -66,6 +157,7 @@ char* paramToolTips[kNumParams] = {
   "Output (dB):\nControls the final output volume",
   "Active:\nSwitches the plugin on or off",
   "Oversampling:\nSwitches between 16x oversampling, or none.\nLack of oversampling will lead to aliasing, especially at higher Drive settings",
+  "Auto oversampling:\nWith oversampling on, steps down to 8x or 4x while the CPU can't keep up, and back to 16x when it can",
 };
 
 class VALUES {
@@ -100,6 +192,7 @@ VALUES paramValues[kNumParams] = {  // (default, minimum, maximum, step)
   // Switches:
   VALUES(true),                         // Active
   VALUES(true),                         // Oversampling
+  VALUES(false),                        // Auto oversampling
 };
 
 IRECT controlCoordinates[kNumParams] = {
@@ -109,11 +202,18 @@ IRECT controlCoordinates[kNumParams] = {
   IRECT(60 + 3*84, 100, 123 + 3*84, 215), // Tone
   IRECT(60 + 4*84, 100, 123 + 4*84, 215), // Output
 
-  IRECT(60 + 5*84, 100, 123 + 5*84, 150), // Active
-  IRECT(60 + 5*84, 165, 123 + 5*84, 215), // Oversampling
+  IRECT(60 + 5*84, 100, 123 + 5*84, 138), // Active
+  IRECT(60 + 5*84, 146, 123 + 5*84, 184), // Oversampling
+  IRECT(60 + 5*84, 192, 123 + 5*84, 230), // Auto oversampling
 
  };
 
+IRECT meterCoordinates[] = {
+  IRECT( 20, 100,  40, 215),              // Input, peak and RMS
+  IRECT(560, 100, 580, 215),              // Output, peak and RMS
+  IRECT( 60, 235, 459, 247),              // Gain reduction, under the big knobs
+};
+
 /////////////////////////////////////////
 
 class Doofuzz final: public Plugin {
@@ -128,38 +228,145 @@ private:
   double  m_Tone            =         paramValues[kParamTone        ].def;
   double  m_Output_Real     = DBToAmp(paramValues[kParamOutput      ].def); // Output gain in real terms, from dB
   double  m_Active          =         paramValues[kParamActive      ].def;  // 0.0..1.0
-  double  m_Oversampling    =         paramValues[kParamOversampling].def;
+
+  // The oversampling mode, from the two switches, as set from whatever thread the host
+  // changes parameters on:
+  std::atomic<int>  m_OSMode  { kOSMode16x };
+
+  // Not smoothed; a change crossfades between the two shaper engines. Audio thread
+  // only, worked out from m_OSMode by followOversamplingMode():
+  EFactor m_Oversampling    = EFactor::k16x;
+  int     m_FollowedOSMode  = kOSMode16x;
+
+  // Where the rip envelope runs, as set from any thread, and as followed by the audio
+  // thread; a change crossfades between the engines, like a change of factor:
+  std::atomic<bool> m_EnvAtBaseRateSetting { kEnvAtBaseRate };
+  bool              m_EnvAtBaseRate        = kEnvAtBaseRate;
+
+  // Auto oversampling; the factor in auto mode, set by governOversampling():
+  EFactor m_AutoFactor          = EFactor::k16x;
+  double  m_AutoOSLoad          = 0.0;  // Averaged fraction of the block time budget in use
+  int     m_AutoOSHoldFrames    = 0;    // Before stepping up is allowed again
+
+  // Per-instance performance statistics, published when DOOFUZZ_TELEMETRY_DIR is set:
+  Doofuzz_Telemetry::Recorder m_Telemetry;
+
+  // The factor of the playing engine, for the UI:
+  std::atomic<int>  m_PlayingFactor { int(EFactor::kNone) };
+  int               m_ShownFactor   = -1;
+
+  DoofuzzMeters     m_Meters { kCtrlTagInputMeter, kCtrlTagOutputMeter, kCtrlTagReductionMeter };
+
+#ifdef DOOFUZZ_SHARED_CHANNEL
+  // Web build: parameter events from the controller, and the meters, through
+  // shared memory (see Doofuzz_SharedChannel.h):
+  Doofuzz_Shared::Channel m_SharedChannel;
+#endif
 
   /////////////////////////////////////////////////////////////////////////////
 
-  ParameterSmoother               smoother = ParameterSmoother(kNumParams);
+  ParameterSmoother<kNumParams>   smoother;
 
-  // Filters etc:
+  // Filters etc. Everything per channel or per pair is only allocated for the
+  // channels in use, in updateStages(true):
 
-  Stereoiser                      m_Stereoiser;
+  std::vector<Stereoiser>         m_Stereoiser;  // One per stereo pair
 
-  Iir::Butterworth::HighPass<1>   m_DCBlockBefore[kMaxNumChannels];
-  Iir::Butterworth::HighPass<1>   m_DCBlockAfter [kMaxNumChannels];
+  ChannelFilters<kMaxNumChannels> m_ChannelFilters;  // DC blocker and post filter, as lanes across channels
 
-  Iir::RBJ::BandShelf             m_Scoop        [kMaxNumChannels];
+  // Coefficients, shared by all channels; those that only depend on the sample rate
+  // also with other instances. Scoop, HighCut and the second DC blocker get combined
+  // into m_PostCoefs:
+  std::shared_ptr<const DoofuzzCoefs> m_Coefs;
+  OnePoleCoefs                    m_HighCutCoefs;
+  SOSCoefs<2>                     m_PostCoefs;
 
-  Iir::Butterworth::LowPass<1>    m_HighCut      [kMaxNumChannels];
+  ShaperEngine<kMaxNumChannels>   m_Engine       [2];
+  int                             m_CurrentEngine  = 0;  // The one playing, or being faded in
+  int                             m_FadeSteps      = 0;
+  int                             m_FadeStepsLeft  = 0;
 
-  WaveShaperDoofuzz               m_Waveshaper   [kMaxNumChannels];
+  int                             m_NumChannels  = 2;  // Channels actually in use; only these get updated
 
-  OverSampler<sample>             m_Oversampler  [kMaxNumChannels] = {
-                                    OverSampler(EFactor::k16x, false),
-                                    OverSampler(EFactor::k16x, false),
-                                  };
+  // Per tile: the parameters per frame, and the signal between the stages, [frame][channel]:
+  TileFrame                       m_Tile         [kTileSize];
+  double                          m_TileRip      [kTileSize];  // Apart, as the engines take them as an array
+  int                             m_TileFadeEnd  = 0;          // Frames from here on no longer need the outgoing engine
+  std::vector<sample>             m_TileX;
+  std::vector<sample>             m_TileY;                     // The outgoing engine's, while fading
+
+  // ProcessBlock runs each stretch of a tile through a kernel specialised for the
+  // channel layout and for the state the frames are in:
+
+  enum ELayout {
+    kLayoutAny = 0,
+    kLayout1to1,
+    kLayout1to2,
+    kLayout2to2,
+    ///////////
+    kNumLayouts
+  };
+
+  enum ERunState {
+    kRunBypassed = 0,   // Active == 0.0
+    kRunActive,         // Active == 1.0
+    kRunTransitioning,  // In between
+    /////////////
+    kNumRunStates
+  };
+
+  static inline ERunState getRunState(double _active) {
+    return (_active == 0.0) ? kRunBypassed : ((_active == 1.0) ? kRunActive : kRunTransitioning);
+  }
+
+  using RunFunc = void (Doofuzz::*)(sample**, sample**, int, int, int, int, int);
+
+  template<int InChans, int OutChans, ERunState State>
+  void processRun(sample** _inputs,
+                  sample** _outputs,
+                  int      _nInChans,
+                  int      _nOutChans,
+                  int      _tile,
+                  int      _from,
+                  int      _to);
 
   inline void updateKnobs();
+  inline int  getOversamplingMode();
   inline void AdjustOversampling();
+  inline void followOversamplingMode(bool _resetting);
+  inline void governOversampling(double _seconds,
+                                 int    _nFrames);
+  inline void updatePostFilter();
+  inline void reserveStages(int _numChannels);
   inline void updateStages(bool _resetting);
 
+  // Per-instance memory: sizeof(Doofuzz) plus everything allocated for the
+  // channels in use, which OnReset() reserves. Measured on x86-64 with double
+  // samples, on top of iPlug's own state and independent of the host's block
+  // size: 37.0 kB for a stereo instance, 22.2 kB for a mono one. For stereo,
+  // that is 14.4 kB per shaper engine (12 kB of which are the work buffers for a
+  // 16x tile), 3.5 kB of per-frame parameters and 1 kB of signal per tile, 256
+  // bytes per stereo pair, 40 bytes per channel of linear filters, 256 bytes of
+  // smoothers and 640 bytes for the meters (with their queue). The 400 bytes of
+  // telemetry counters are only allocated while publishing. Only the playing
+  // engine is touched outside of crossfades. The 1.2 kB of DoofuzzCoefs are
+  // shared by all instances at the same rate, so not counted. Reported in debug
+  // builds at every reset.
+  size_t getFootprintBytes() const;
+
 public:
   Doofuzz(const InstanceInfo& info);
+#ifdef DOOFUZZ_SHARED_CHANNEL
+  Doofuzz_Shared::Channel* getSharedChannel() { return &m_SharedChannel; }
+#endif
+  // Runs the rip envelope at base rate rather than oversampled (kEnvAtBaseRate is
+  // the default). From any thread; takes effect within a block, crossfaded:
+  void setEnvelopeAtBaseRate(bool _atBaseRate) {
+    m_EnvAtBaseRateSetting.store(_atBaseRate, std::memory_order_relaxed);
+  }
   void OnReset() override;
   void OnParamChange(int paramIdx) override;
+  void OnIdle() override;
   void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override;
 
 };
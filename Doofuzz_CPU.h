@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+
+// Runtime choice between kernels compiled for different instruction set levels.
+//
+// One binary has to run on anything from old SSE2-only machines up to AVX-512 ones,
+// so the project is built for the baseline (SSE2 on x86-64, NEON on arm64), and the
+// hot kernels get extra copies for AVX2 and AVX-512, picked once per process from
+// what the CPU reports. Setting the environment variable DOOFUZZ_CPU_LEVEL to
+// "baseline", "avx2" or "avx512" forces a lower level, for testing and benchmarking
+// every variant on one machine.
+//
+// Extra copies need per-function target attributes, so only GCC and Clang on x86
+// get them; everywhere else (MSVC, arm64) there is just the baseline kernel. On
+// WebAssembly, SIMD128 is a build option instead (config/Doofuzz-web.mk), as a
+// module can't hold code the browser doesn't support.
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define DOOFUZZ_CPU_DISPATCH    1
+  #define DOOFUZZ_TARGET(isa)     __attribute__((target(isa)))
+#else
+  #define DOOFUZZ_CPU_DISPATCH    0
+  #define DOOFUZZ_TARGET(isa)
+#endif
+
+// For everything a kernel calls, so that it gets compiled into each variant instead
+// of being called at baseline level:
+#if defined(__GNUC__) || defined(__clang__)
+  #define DOOFUZZ_KERNEL_INLINE   inline __attribute__((always_inline))
+  #define DOOFUZZ_LAMBDA_INLINE   __attribute__((always_inline))
+#elif defined(_MSC_VER)
+  #define DOOFUZZ_KERNEL_INLINE   __forceinline
+  #define DOOFUZZ_LAMBDA_INLINE
+#else
+  #define DOOFUZZ_KERNEL_INLINE   inline
+  #define DOOFUZZ_LAMBDA_INLINE
+#endif
+
+// With FMA, the levels differ from the baseline in rounding only (around 1e-15):
+#define DOOFUZZ_TARGET_AVX2       DOOFUZZ_TARGET("avx2,fma")
+#define DOOFUZZ_TARGET_AVX512     DOOFUZZ_TARGET("avx512f,avx512dq,avx512vl,avx2,fma")
+
+namespace Doofuzz_CPU {
+
+  enum ECPULevel {
+    kCPUBaseline = 0,
+    kCPUAVX2,
+    kCPUAVX512,
+    ///////////
+    kNumCPULevels
+  };
+
+  const char* const kCPULevelNames[kNumCPULevels] = {
+    "baseline",
+    "avx2",
+    "avx512",
+  };
+
+  inline ECPULevel detectCPULevel() {
+
+    ECPULevel level = kCPUBaseline;
+
+#if DOOFUZZ_CPU_DISPATCH
+    // These also check that the OS saves the wider registers:
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      level = kCPUAVX2;
+      if (__builtin_cpu_supports("avx512f")  &&
+          __builtin_cpu_supports("avx512dq") &&
+          __builtin_cpu_supports("avx512vl")) {
+        level = kCPUAVX512;
+      }
+    }
+#endif
+
+    // Forcing can only go down; a level the CPU lacks would crash:
+    if (const char* forced = std::getenv("DOOFUZZ_CPU_LEVEL")) {
+      for (int l = 0; l < kNumCPULevels; l++) {
+        if ((std::strcmp(forced, kCPULevelNames[l]) == 0) && (l < level)) {
+          level = ECPULevel(l);
+        }
+      }
+    }
+
+    return level;
+  }
+
+  // Detected once, then shared by all instances:
+  inline ECPULevel getCPULevel() {
+    static const ECPULevel level = detectCPULevel();
+    return level;
+  }
+
+};
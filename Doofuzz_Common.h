@@ -1,11 +1,20 @@
 #pragma once
 
 #include <tgmath.h>
+#include <cstdint>
 
 namespace Doofuzz_Common {
 
-  const double  _PI       = 3.14159265358979323846264338327950288419716939937510;
-  const double  _HALF_PI  = _PI / 2.0;
+  const double  _PI             = 3.14159265358979323846264338327950288419716939937510;
+  const double  _HALF_PI        = _PI / 2.0;
+
+  const size_t  kCacheLineSize  = 64;
+
+  // Rounds a pointer up to the start of the next cache line:
+  template<typename T>
+  inline T* alignToCacheLine(T* _ptr) {
+    return (T*)((uintptr_t(_ptr) + kCacheLineSize - 1) & ~uintptr_t(kCacheLineSize - 1));
+  }
 
   #ifdef _DEBUG
     #ifdef _MSC_VER
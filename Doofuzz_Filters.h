@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include "Doofuzz_Common.h"
+#include "Doofuzz_CPU.h"
+#include "iir1/Iir.h"
+
+using namespace Doofuzz_Common;
+
+// Lean filter kernels for the hot path: fixed order, no virtual calls, state and
+// coefficients kept apart so that coefficients can be shared, between channels and
+// (see Doofuzz_SharedCache.h) between instances. First-order filters are designed
+// here; biquads are designed by iir1, and their coefficients copied (and combined)
+// into these. iir1 itself no longer runs on the audio thread.
+//
+// The *Lanes variants run N independent filters side by side on N inputs, with the
+// lane loop innermost, for the compiler to vectorise.
+
+///////////////////////////////////////////////////////////////////////////////
+
+// One first-order section, a0 normalised to 1. Bilinear-transformed Butterworth
+// designs, like iir1's, except that the high-pass doesn't invert polarity. Cutoffs
+// at or above Nyquist (Tone goes up to 20 kHz, also at 22.05 kHz) would be unstable,
+// so they get limited to kMaxCutoff of the sample rate:
+struct OnePoleCoefs {
+
+  static  const inline  double  kMaxCutoff  = 0.49;
+
+  double b0 = 1.0;
+  double b1 = 0.0;
+  double a1 = 0.0;
+
+  static inline OnePoleCoefs lowPass(double _sampleRate,
+                                     double _cutoff) {
+    const double k = tan(_PI * std::min(_cutoff, kMaxCutoff * _sampleRate) / _sampleRate);
+    OnePoleCoefs c;
+    c.b0 = k / (1.0 + k);
+    c.b1 = c.b0;
+    c.a1 = (k - 1.0) / (k + 1.0);
+    return c;
+  }
+
+  static inline OnePoleCoefs highPass(double _sampleRate,
+                                      double _cutoff) {
+    const double k = tan(_PI * std::min(_cutoff, kMaxCutoff * _sampleRate) / _sampleRate);
+    OnePoleCoefs c;
+    c.b0 = 1.0 / (1.0 + k);
+    c.b1 = -c.b0;
+    c.a1 = (k - 1.0) / (k + 1.0);
+    return c;
+  }
+
+  inline OnePoleCoefs& scale(double _gain) {
+    b0 *= _gain;
+    b1 *= _gain;
+    return *this;
+  }
+
+};
+
+// The state of one first-order filter, in transposed direct form II:
+class OnePole {
+public:
+
+  inline void reset() {
+    m_S = 0.0;
+  }
+
+  inline double process(const OnePoleCoefs& _coefs,
+                        double              _x) {
+    const double y = _coefs.b0 * _x + m_S;
+    m_S = _coefs.b1 * _x - _coefs.a1 * y;
+    return y;
+  }
+
+  // _numFrames samples, _stride apart (for interleaved buffers), in place:
+  inline void processBlock(const OnePoleCoefs& _coefs,
+                           double*             _io,
+                           int                 _numFrames,
+                           int                 _stride = 1) {
+    for (int f = 0; f < _numFrames; f++, _io += _stride) {
+      *_io = process(_coefs, *_io);
+    }
+  }
+
+private:
+
+  double m_S = 0.0;
+
+};
+
+// Coefficients of NumLanes first-order filters, one set per lane. Designed in double,
+// run in T:
+template<int NumLanes, typename T = double>
+struct OnePoleLaneCoefs {
+
+  T b0[NumLanes] = {};
+  T b1[NumLanes] = {};
+  T a1[NumLanes] = {};
+
+  inline void setup(int                 _lane,
+                    const OnePoleCoefs& _coefs) {
+    b0[_lane] = T(_coefs.b0);
+    b1[_lane] = T(_coefs.b1);
+    a1[_lane] = T(_coefs.a1);
+  }
+
+};
+
+// The state of NumLanes first-order filters running side by side:
+template<int NumLanes, typename T = double>
+class OnePoleLanes {
+public:
+
+  inline void reset() {
+    std::fill(m_S, m_S + NumLanes, T(0.0));
+  }
+
+  DOOFUZZ_KERNEL_INLINE void process(const OnePoleLaneCoefs<NumLanes, T>& _coefs,
+                                     const T*                             _x,
+                                     T*                                   _y) {
+    for (int l = 0; l < NumLanes; l++) {
+      const T y = _coefs.b0[l] * _x[l] + m_S[l];
+      m_S[l] = _coefs.b1[l] * _x[l] - _coefs.a1[l] * y;
+      _y[l] = y;
+    }
+  }
+
+  // The same input into every lane:
+  DOOFUZZ_KERNEL_INLINE void process(const OnePoleLaneCoefs<NumLanes, T>& _coefs,
+                                     T                                    _x,
+                                     T*                                   _y) {
+    for (int l = 0; l < NumLanes; l++) {
+      const T y = _coefs.b0[l] * _x + m_S[l];
+      m_S[l] = _coefs.b1[l] * _x - _coefs.a1[l] * y;
+      _y[l] = y;
+    }
+  }
+
+private:
+
+  T m_S[NumLanes] = {};
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// One second-order section, a0 normalised to 1:
+struct BiquadCoefs {
+
+  double b0 = 1.0;
+  double b1 = 0.0;
+  double b2 = 0.0;
+  double a1 = 0.0;
+  double a2 = 0.0;
+
+  // Design-time only:
+  static inline BiquadCoefs fromIir(const Iir::Biquad& _biquad) {
+    const double a0 = _biquad.getA0();
+    BiquadCoefs c;
+    c.b0 = _biquad.getB0() / a0;
+    c.b1 = _biquad.getB1() / a0;
+    c.b2 = _biquad.getB2() / a0;
+    c.a1 = _biquad.getA1() / a0;
+    c.a2 = _biquad.getA2() / a0;
+    return c;
+  }
+
+  // Two first-order sections combined into one second-order one:
+  static inline BiquadCoefs fromFirstOrders(const OnePoleCoefs& _first,
+                                            const OnePoleCoefs& _second) {
+    BiquadCoefs c;
+    c.b0 = _first.b0 * _second.b0;
+    c.b1 = _first.b0 * _second.b1 + _first.b1 * _second.b0;
+    c.b2 = _first.b1 * _second.b1;
+    c.a1 = _first.a1 + _second.a1;
+    c.a2 = _first.a1 * _second.a1;
+    return c;
+  }
+
+  inline BiquadCoefs& scale(double _gain) {
+    b0 *= _gain;
+    b1 *= _gain;
+    b2 *= _gain;
+    return *this;
+  }
+
+};
+
+// Coefficients of a cascade of second-order sections, shared by all channels
+// running the same filter:
+template<int NumSections>
+struct SOSCoefs {
+  BiquadCoefs section[NumSections];
+};
+
+// The state of one channel running an SOSCoefs, in transposed direct form II:
+template<int NumSections>
+class SOSCascade {
+public:
+
+  inline void reset() {
+    std::fill(&m_S[0][0], &m_S[0][0] + 2 * NumSections, 0.0);
+  }
+
+  inline double process(const SOSCoefs<NumSections>& _coefs,
+                        double                       _x) {
+    for (int s = 0; s < NumSections; s++) {
+      const BiquadCoefs& c = _coefs.section[s];
+      const double y = c.b0 * _x + m_S[s][0];
+      m_S[s][0] = c.b1 * _x - c.a1 * y + m_S[s][1];
+      m_S[s][1] = c.b2 * _x - c.a2 * y;
+      _x = y;
+    }
+    return _x;
+  }
+
+  // _numFrames samples, _stride apart (for interleaved buffers), in place:
+  inline void processBlock(const SOSCoefs<NumSections>& _coefs,
+                           double*                      _io,
+                           int                          _numFrames,
+                           int                          _stride = 1) {
+    for (int f = 0; f < _numFrames; f++, _io += _stride) {
+      *_io = process(_coefs, *_io);
+    }
+  }
+
+private:
+
+  double m_S[NumSections][2] = {};
+
+};
+
+// Coefficients of NumLanes biquads, one set per lane:
+template<int NumLanes>
+struct BiquadLaneCoefs {
+
+  double b0[NumLanes] = {};
+  double b1[NumLanes] = {};
+  double b2[NumLanes] = {};
+  double a1[NumLanes] = {};
+  double a2[NumLanes] = {};
+
+  inline void setup(int                 _lane,
+                    const BiquadCoefs&  _coefs) {
+    b0[_lane] = _coefs.b0;
+    b1[_lane] = _coefs.b1;
+    b2[_lane] = _coefs.b2;
+    a1[_lane] = _coefs.a1;
+    a2[_lane] = _coefs.a2;
+  }
+
+};
+
+// The state of NumLanes biquads running side by side, in transposed direct form II:
+template<int NumLanes>
+class BiquadLanes {
+public:
+
+  inline void reset() {
+    std::fill(m_S1, m_S1 + NumLanes, 0.0);
+    std::fill(m_S2, m_S2 + NumLanes, 0.0);
+  }
+
+  // In place:
+  inline void process(const BiquadLaneCoefs<NumLanes>& _coefs,
+                      double*                          _x) {
+    for (int l = 0; l < NumLanes; l++) {
+      const double y = _coefs.b0[l] * _x[l] + m_S1[l];
+      m_S1[l] = _coefs.b1[l] * _x[l] - _coefs.a1[l] * y + m_S2[l];
+      m_S2[l] = _coefs.b2[l] * _x[l] - _coefs.a2[l] * y;
+      _x[l] = y;
+    }
+  }
+
+private:
+
+  double m_S1[NumLanes] = {};
+  double m_S2[NumLanes] = {};
+
+};
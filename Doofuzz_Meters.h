@@ -0,0 +1,246 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include "IPlug_include_in_plug_hdr.h"
+#include "ISender.h"
+#include "Doofuzz_SharedChannel.h"
+
+using namespace iplug;
+
+// Input and output level (peak and RMS) and gain reduction, for the meters in the UI.
+//
+// The audio thread only keeps running summaries of its blocks: a peak and a sum of
+// squares per side, a couple of operations per sample. Every kIntervalMs those get
+// turned into meter positions and pushed through an iPlug sender, a lock-free queue
+// that OnIdle() drains into the meter controls, which then redraw just their own
+// rectangles. Positions that haven't visibly moved since the last push don't get
+// pushed again, so meters at rest (a silent track, a closed editor's instance) cost
+// the UI thread nothing. In the web build, the positions can go through a shared
+// memory channel instead (see Doofuzz_SharedChannel.h).
+//
+// Gain reduction is how far the output falls short of the input times the gain the
+// plugin would apply without its fuzz (Drive and Output, scaled by Active), so it
+// also shows what Tone and the scoop take away.
+class DoofuzzMeters {
+private:
+
+  static  const inline  double  kIntervalMs           = 1000.0 / 30.0;  // Meter updates per second: 30
+  static  const inline  double  kLevelFloor_dB        =  -60.0;         // Bottom of the level meters; top is 0 dBFS
+  static  const inline  double  kReductionRange_dB    =   96.0;         // Full scale of the reduction meter, as of Drive
+  static  const inline  double  kPeakFall_dBPerSec    =   24.0;         // Peak release
+  static  const inline  double  kSilence              =    1.0e-6;      // Input RMS below which there's nothing to reduce
+  static  const inline  float   kMinMove              =    0.004f;      // Of a meter's height, before it's worth a redraw
+
+public:
+
+  static  const inline  int     kQueueSize            =   32;
+
+  enum ETracks {
+    kTrackPeak = 0,
+    kTrackRMS,
+    //////////
+    kNumTracks
+  };
+
+  using Sender  = ISender<kNumTracks, kQueueSize>;
+  using Data    = ISenderData<kNumTracks>;
+
+  DoofuzzMeters(int _inputTag,
+                int _outputTag,
+                int _reductionTag) :
+    m_Tag { _inputTag, _outputTag, _reductionTag } {}
+
+  inline void reset(double _sampleRate) {
+
+    m_IntervalFrames  = std::max(1, int(_sampleRate * kIntervalMs / 1000.0));
+    m_FramesLeft      = m_IntervalFrames;
+    m_PeakFall_dB     = kPeakFall_dBPerSec * kIntervalMs / 1000.0;
+
+    for (int s = 0; s < kNumSides; s++) {
+      m_Summary[s]  = Summary();
+      m_Peak_dB[s]  = kLevelFloor_dB;
+    }
+
+    m_Resend.store(true, std::memory_order_relaxed);
+
+  }
+
+  // Once a controller is attached to _channel, all positions go there on every
+  // update, and nothing through the sender. _channel has to outlive this:
+  inline void mirrorTo(Doofuzz_Shared::Channel* _channel) {
+    m_Shared = _channel;
+  }
+
+  // From the UI thread, when the meter controls have just been created:
+  inline void resend() {
+    m_Resend.store(true, std::memory_order_relaxed);
+  }
+
+  // The host's input, before anything else in the block (input and output buffers
+  // may be the same). Returns the block's peak:
+  inline double addInput(sample** _inputs,
+                         int      _nChans,
+                         int      _nFrames) {
+    return m_Summary[kSideInput].add(_inputs, _nChans, _nFrames);
+  }
+
+  // The output, at the end of the block; _dryGain_Real is the gain without the fuzz:
+  inline void addOutput(sample** _outputs,
+                        int      _nChans,
+                        int      _nFrames,
+                        double   _dryGain_Real) {
+
+    m_Summary[kSideOutput].add(_outputs, _nChans, _nFrames);
+
+    if ((m_FramesLeft -= _nFrames) <= 0) {
+      publish(_dryGain_Real);
+      m_FramesLeft = m_IntervalFrames;
+    }
+
+  }
+
+  // From OnIdle(), on the UI thread:
+  inline void transmit(IEditorDelegate& _delegate) {
+    m_Sender.TransmitData(_delegate);
+  }
+
+  size_t getHeapSize() const {
+    return kQueueSize * sizeof(Data);
+  }
+
+private:
+
+  enum ESides {
+    kSideInput = 0,
+    kSideOutput,
+    ////////////
+    kNumSides
+  };
+
+  struct Summary {
+    double  m_Peak        = 0.0;
+    double  m_SumSquares  = 0.0;
+    int     m_NumSamples  = 0;
+
+    // Returns the peak of just these frames:
+    inline double add(sample** _buffers,
+                      int      _nChans,
+                      int      _nFrames) {
+
+      double peak       = 0.0;
+      double sumSquares = 0.0;
+
+      for (int ch = 0; ch < _nChans; ch++) {
+        const sample* x = _buffers[ch];
+        for (int f = 0; f < _nFrames; f++) {
+          peak        = std::max(peak, double(std::fabs(x[f])));
+          sumSquares += x[f] * x[f];
+        }
+      }
+
+      m_Peak        = std::max(m_Peak, peak);
+      m_SumSquares += sumSquares;
+      m_NumSamples += _nChans * _nFrames;
+
+      return peak;
+    }
+
+    inline double getRMS() const {
+      return (m_NumSamples > 0) ? std::sqrt(m_SumSquares / m_NumSamples) : 0.0;
+    }
+  };
+
+  static inline double toDB(double _amp) {
+    return (_amp > 0.0) ? AmpToDB(_amp) : -1000.0;
+  }
+
+  // 0.0..1.0 from kLevelFloor_dB to 0 dBFS:
+  static inline float levelPosition(double _dB) {
+    return float(std::clamp(1.0 - _dB / kLevelFloor_dB, 0.0, 1.0));
+  }
+
+  inline void publish(double _dryGain_Real) {
+
+    const bool resend = m_Resend.exchange(false, std::memory_order_relaxed);
+
+    Data data[kNumSides + 1];
+
+    for (int s = 0; s < kNumSides; s++) {
+
+      // Peaks fall back slowly, so that short ones can still be seen:
+      m_Peak_dB[s] = std::max(toDB(m_Summary[s].m_Peak), m_Peak_dB[s] - m_PeakFall_dB);
+
+      data[s] = Data(m_Tag[s], kNumTracks, 0);
+      data[s].vals[kTrackPeak] = levelPosition(m_Peak_dB[s]);
+      data[s].vals[kTrackRMS]  = levelPosition(toDB(m_Summary[s].getRMS()));
+
+    }
+
+    const double inputRMS   = m_Summary[kSideInput ].getRMS();
+    const double outputRMS  = m_Summary[kSideOutput].getRMS();
+    double       reduction  = 0.0;
+
+    if ((inputRMS > kSilence) && (outputRMS > 0.0)) {
+      reduction = toDB(inputRMS * _dryGain_Real / outputRMS);
+    }
+
+    data[kNumSides] = Data(m_Tag[kNumSides], 1, 0);
+    data[kNumSides].vals[0] = float(std::clamp(reduction / kReductionRange_dB, 0.0, 1.0));
+
+    if (m_Shared && m_Shared->isAttached()) {
+
+      // Input peak and RMS, output peak and RMS, reduction:
+      static_assert(kNumTracks * (kNumSides + 1) <= Doofuzz_Shared::Channel::kNumMeterValues, "Meters don't fit the channel");
+      float values[kNumTracks * (kNumSides + 1)];
+      int   numValues = 0;
+      for (int m = 0; m <= kNumSides; m++) {
+        for (int t = 0; t < data[m].nChans; t++) {
+          values[numValues++] = data[m].vals[t];
+        }
+      }
+      m_Shared->writeMeters(values, numValues);
+
+    } else {
+
+      for (int m = 0; m <= kNumSides; m++) {
+
+        bool moved = resend;
+        for (int t = 0; t < data[m].nChans; t++) {
+          moved |= (std::fabs(data[m].vals[t] - m_Sent[m][t]) >= kMinMove);
+        }
+
+        if (moved) {
+          m_Sender.PushData(data[m]);  // Dropped when the UI thread falls behind; the next one will do
+          for (int t = 0; t < data[m].nChans; t++) {
+            m_Sent[m][t] = data[m].vals[t];
+          }
+        }
+
+      }
+
+    }
+
+    for (int s = 0; s < kNumSides; s++) {
+      m_Summary[s] = Summary();
+    }
+
+  }
+
+  const int         m_Tag         [kNumSides + 1];        // Input, output, reduction
+
+  Summary           m_Summary     [kNumSides];
+  double            m_Peak_dB     [kNumSides]     = {};
+  float             m_Sent        [kNumSides + 1][kNumTracks] = {};
+  double            m_PeakFall_dB   = 0.0;
+  int               m_IntervalFrames  = 1;
+  int               m_FramesLeft      = 1;
+
+  std::atomic<bool> m_Resend      { true };
+
+  Doofuzz_Shared::Channel*  m_Shared  = nullptr;
+
+  Sender            m_Sender;
+
+};
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include "Oversampler.h"  // For EFactor
+#include "Doofuzz_Common.h"
+#include "Doofuzz_CPU.h"
+
+using namespace iplug;
+using namespace Doofuzz_Common;
+
+// One 2x up- or downsampling stage: a polyphase half-band IIR filter (two chains of
+// first-order all-passes, after Laurent de Soras' HIIR), the same design iPlug's
+// OverSampler uses. The state is laid out [coefficient][channel], so that each
+// all-pass runs over all interleaved channels in one loop the compiler can vectorise.
+// The state itself lives in the owning oversampler, packed for the channels in use.
+// Runs in sample precision, so in float where iPlug is built with SAMPLE_TYPE_FLOAT
+// (the web build), which doubles the number of channels per SIMD vector.
+template<int MaxChannels>
+class HalfBandStage {
+public:
+
+  inline void setup(const sample* _coefs,
+                    int           _numCoefs) {
+    m_Coefs     = _coefs;
+    m_NumCoefs  = _numCoefs;
+  }
+
+  inline int getStateSize(int _numChans) const {
+    return 2 * m_NumCoefs * _numChans;
+  }
+
+  inline void attach(sample*  _state,
+                     int      _numChans) {
+    m_X         = _state;
+    m_Y         = _state + m_NumCoefs * _numChans;
+    m_NumChans  = _numChans;
+    clear();
+  }
+
+  inline void clear() {
+    std::fill(m_X, m_X + getStateSize(m_NumChans), sample(0.0));
+  }
+
+  // _numFrames interleaved input frames in, 2 * _numFrames interleaved frames out:
+  DOOFUZZ_KERNEL_INLINE void upsample(const sample*  _in,
+                                      sample*        _out,
+                                      int            _numFrames,
+                                      int            _numChans) {
+
+    for (int f = 0; f < _numFrames; f++, _in += _numChans, _out += 2 * _numChans) {
+
+      sample even[MaxChannels];
+      sample odd [MaxChannels];
+
+      for (int ch = 0; ch < _numChans; ch++) {
+        even[ch] = odd[ch] = _in[ch];
+      }
+
+      runAllPasses(even, odd, _numChans);
+
+      for (int ch = 0; ch < _numChans; ch++) {
+        _out[ch]             = even[ch];
+        _out[ch + _numChans] = odd [ch];
+      }
+    }
+  }
+
+  // 2 * _numFrames interleaved input frames in, _numFrames interleaved frames out:
+  DOOFUZZ_KERNEL_INLINE void downsample(const sample*  _in,
+                                        sample*        _out,
+                                        int            _numFrames,
+                                        int            _numChans) {
+
+    for (int f = 0; f < _numFrames; f++, _in += 2 * _numChans, _out += _numChans) {
+
+      sample path0[MaxChannels];
+      sample path1[MaxChannels];
+
+      for (int ch = 0; ch < _numChans; ch++) {
+        path0[ch] = _in[ch + _numChans];
+        path1[ch] = _in[ch];
+      }
+
+      runAllPasses(path0, path1, _numChans);
+
+      for (int ch = 0; ch < _numChans; ch++) {
+        _out[ch] = sample(0.5) * (path0[ch] + path1[ch]);
+      }
+    }
+  }
+
+private:
+
+  DOOFUZZ_KERNEL_INLINE void runAllPasses(sample* _path0,
+                                          sample* _path1,
+                                          int     _numChans) {
+
+    // Even coefficients belong to the first path, odd ones to the second:
+    for (int i = 0; i < m_NumCoefs; i++) {
+
+      sample*       path  = (i & 1) ? _path1 : _path0;
+      const sample  c     = m_Coefs[i];
+      sample*       x     = m_X + i * _numChans;
+      sample*       y     = m_Y + i * _numChans;
+
+      for (int ch = 0; ch < _numChans; ch++) {
+        const sample out = (path[ch] - y[ch]) * c + x[ch];
+        x[ch]     = path[ch];
+        y[ch]     = out;
+        path[ch]  = out;
+      }
+    }
+  }
+
+  const sample* m_Coefs     = nullptr;
+  int           m_NumCoefs  = 0;
+  int           m_NumChans  = 0;
+
+  sample*       m_X         = nullptr;  // [coefficient][channel]
+  sample*       m_Y         = nullptr;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Oversamples, shapes and downsamples all channels of a bus together, on
+// interleaved buffers. Supports the same factors as iPlug's OverSampler (kNone
+// up to k16x). Instead of calling a lambda per channel per oversampled sample,
+// the shaper is called once per block with all oversampled, interleaved frames.
+template<int MaxChannels>
+class MultiChannelOverSampler {
+public:
+
+  MultiChannelOverSampler(EFactor _factor = EFactor::kNone) {
+    for (int s = 0; s < kMaxNumStages; s++) {
+      m_Upsampler  [s].setup(kCoefs[s], kNumCoefs[s]);
+      m_Downsampler[s].setup(kCoefs[s], kNumCoefs[s]);
+    }
+    setOverSampling(_factor);
+  }
+
+  // Allocates for up to _numChannels and _maxBlockSize, so that later calls to reset()
+  // within those limits don't allocate. Doesn't change anything else:
+  inline void reserve(int _maxBlockSize,
+                      int _numChannels) {
+
+    const int numChannels = std::clamp(_numChannels, 1, MaxChannels);
+
+    m_State.reserve(getStateSize(numChannels));
+    for (int b = 0; b < 2; b++) {
+      m_Buffer[b].reserve(getBufferSize(b, _maxBlockSize, numChannels));
+    }
+  }
+
+  // Sizes the filter states for the channels in use, and the work buffers for the
+  // highest factor, so that switching factors later never allocates. Only
+  // allocates when growing beyond what was reserved. Clears all filter states.
+  inline void reset(int _maxBlockSize,
+                    int _numChannels) {
+
+    m_NumChannels = std::clamp(_numChannels, 1, MaxChannels);
+
+    // All stage states in one cache-line-aligned block:
+    m_State.resize(std::max(m_State.size(), getStateSize(m_NumChannels)));
+
+    sample* state = alignToCacheLine(m_State.data());
+    for (int s = 0; s < kMaxNumStages; s++) {
+      m_Upsampler  [s].attach(state, m_NumChannels);
+      state += m_Upsampler  [s].getStateSize(m_NumChannels);
+      m_Downsampler[s].attach(state, m_NumChannels);
+      state += m_Downsampler[s].getStateSize(m_NumChannels);
+    }
+
+    for (int b = 0; b < 2; b++) {
+      m_Buffer[b].resize(std::max(m_Buffer[b].size(), getBufferSize(b, _maxBlockSize, m_NumChannels)));
+    }
+    m_MaxBlockSize = _maxBlockSize;
+
+    clear();
+  }
+
+  // Heap bytes in use, for footprint accounting:
+  inline size_t getHeapSize() const {
+    return (m_State.capacity() + m_Buffer[0].capacity() + m_Buffer[1].capacity()) * sizeof(sample);
+  }
+
+  inline void clear() {
+    if (m_State.empty()) {
+      return;
+    }
+    for (int s = 0; s < kMaxNumStages; s++) {
+      m_Upsampler  [s].clear();
+      m_Downsampler[s].clear();
+    }
+  }
+
+  inline void setOverSampling(EFactor _factor) {
+    if (_factor != m_Factor) {
+      m_Factor = _factor;
+      clear();
+    }
+  }
+
+  inline EFactor getFactor() const {
+    return m_Factor;
+  }
+
+  inline int getRate() const {
+    return 1 << int(m_Factor);
+  }
+
+  inline int getNumChannels() const {
+    return m_NumChannels;
+  }
+
+  // _io holds _numFrames interleaved frames of getNumChannels() channels, and is
+  // processed in place. _shape is called as _shape(sample* interleaved,
+  // int numChannels, int numOversampledFrames), and shapes in place too.
+  template<typename ShapeFunc>
+  DOOFUZZ_KERNEL_INLINE void process(sample*     _io,
+                                     int         _numFrames,
+                                     ShapeFunc&& _shape) {
+
+    assert(_numFrames <= m_MaxBlockSize);
+
+    const int numStages = int(m_Factor);
+
+    if (numStages == 0) {
+      _shape(_io, m_NumChannels, _numFrames);
+      return;
+    }
+
+    // Up, ping-ponging between the two work buffers:
+    const sample* in  = _io;
+    int           n   = _numFrames;
+    int           b   = 0;
+
+    for (int s = 0; s < numStages; s++, n *= 2, b ^= 1) {
+      m_Upsampler[s].upsample(in, m_Buffer[b].data(), n, m_NumChannels);
+      in = m_Buffer[b].data();
+    }
+
+    sample* os = m_Buffer[b ^ 1].data();
+
+    _shape(os, m_NumChannels, n);
+
+    // And down again, the last stage writing straight into _io:
+    for (int s = numStages - 1; s >= 0; s--, b ^= 1) {
+      n /= 2;
+      sample* out = (s == 0) ? _io : m_Buffer[b].data();
+      m_Downsampler[s].downsample(os, out, n, m_NumChannels);
+      os = out;
+    }
+  }
+
+private:
+
+  static const inline int kMaxNumStages = int(EFactor::k16x);
+
+  // All stage states, plus room for aligning them to a cache line:
+  inline size_t getStateSize(int _numChannels) const {
+    size_t size = kCacheLineSize / sizeof(sample);
+    for (int s = 0; s < kMaxNumStages; s++) {
+      size += m_Upsampler  [s].getStateSize(_numChannels);
+      size += m_Downsampler[s].getStateSize(_numChannels);
+    }
+    return size;
+  }
+
+  // Upsampling stage s writes into buffer s & 1, so at 16x the first buffer never
+  // holds more than 8x:
+  static inline size_t getBufferSize(int _buffer,
+                                     int _maxBlockSize,
+                                     int _numChannels) {
+    size_t size = 0;
+    for (int s = _buffer; s < kMaxNumStages; s += 2) {
+      size = size_t(_maxBlockSize) * (size_t(2) << s) * _numChannels;
+    }
+    return size;
+  }
+
+  // Polyphase half-band coefficients per 2x stage, from HIIR's designer
+  // (transition bandwidths 0.01, 0.255, 0.3775 and 0.43865). The first stage
+  // needs the steepest filter; later stages only have to reject their images.
+  static constexpr sample kCoefs2x [12] = { 0.036681502163648017, 0.13654762463195794,
+                                            0.27463175937945444,  0.42313861743656711,
+                                            0.56109869787919531,  0.67754004997416184,
+                                            0.76974183386322703,  0.83988962484963892,
+                                            0.89226081800387902,  0.9315419599631839,
+                                            0.96209454837808417,  0.98781637073289585 };
+  static constexpr sample kCoefs4x [ 4] = { 0.041893991997656171, 0.16890348243995201,
+                                            0.39056077292116603,  0.74389574826847926 };
+  static constexpr sample kCoefs8x [ 3] = { 0.055748680811302048, 0.24305119574153072,
+                                            0.64669913119268196 };
+  static constexpr sample kCoefs16x[ 2] = { 0.10717745346023573,  0.53091435354504557 };
+
+  static constexpr const sample*  kCoefs   [kMaxNumStages] = { kCoefs2x, kCoefs4x, kCoefs8x, kCoefs16x };
+  static constexpr int            kNumCoefs[kMaxNumStages] = { 12,       4,        3,        2         };
+
+  EFactor                       m_Factor        = EFactor::kNone;
+  int                           m_NumChannels   = 1;
+  int                           m_MaxBlockSize  = 0;
+
+  HalfBandStage<MaxChannels>    m_Upsampler  [kMaxNumStages];
+  HalfBandStage<MaxChannels>    m_Downsampler[kMaxNumStages];
+
+  std::vector<sample>           m_State;
+  std::vector<sample>           m_Buffer[2];
+
+};
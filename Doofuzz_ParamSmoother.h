@@ -15,24 +15,21 @@ struct Smoother {
   IParam::EDisplayType  m_DisplayType = IParam::EDisplayType::kDisplayLinear;
 };
 
+// Sized at compile time, so it lives inside the plugin instead of in a separate
+// heap block:
+template<int NumParams>
 class ParameterSmoother {
 
 private:
-  Smoother* m_smoothers = NULL;
+  Smoother m_smoothers[NumParams];
 
 public:
-  ParameterSmoother(int _numParams) {
-    m_smoothers = new Smoother[_numParams];
-  };
-  ~ParameterSmoother() {
-    delete[] m_smoothers;
-  };
 
   inline void reset(Plugin*           _plugin,
                     double            _smoothingTimeMs) {
 
     const double  sr        = _plugin->GetSampleRate();
-    const int     numParams = _plugin->NParams();
+    const int     numParams = std::min(_plugin->NParams(), NumParams);
 
     for (auto p = 0; p < numParams; p++) {
 
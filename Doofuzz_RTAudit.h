@@ -0,0 +1,53 @@
+#pragma once
+
+// Real-time-safety audit, for test builds only: with DOOFUZZ_RT_AUDIT defined,
+// ProcessBlock runs inside an RTAuditScope, and anything that allocates from the heap,
+// locks, sleeps or writes files while a scope is active on the calling thread is
+// reported on stderr, and aborts. operator new/delete, plain and over-aligned (so
+// standard containers and std::shared_ptr, whatever they hold), are replaced in
+// Doofuzz.cpp; the C library's allocators, locks and blocking calls get wrapped at
+// link time by tests/rt_audit_stress.cpp, so that nothing has to be annotated at
+// the places that call them.
+//
+// Without DOOFUZZ_RT_AUDIT, all of this compiles to nothing.
+
+#ifdef DOOFUZZ_RT_AUDIT
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+  #include <malloc.h>  // _aligned_malloc
+#endif
+
+namespace Doofuzz_RTAudit {
+
+  inline thread_local int tl_ScopeDepth = 0;
+
+  // Marks the calling thread as the audio thread, for as long as it lives:
+  class RTAuditScope {
+  public:
+    RTAuditScope()  { tl_ScopeDepth++; }
+    ~RTAuditScope() { tl_ScopeDepth--; }
+  };
+
+  inline void check(const char* _what) {
+    if (tl_ScopeDepth > 0) {
+      tl_ScopeDepth = 0;  // Reporting might allocate itself
+      std::fprintf(stderr, "Doofuzz: real-time violation on the audio thread: %s\n", _what);
+      std::abort();
+    }
+  }
+
+};
+
+#define RT_AUDIT_SCOPE        Doofuzz_RTAudit::RTAuditScope rtAuditScope
+#define RT_AUDIT_CHECK(what)  Doofuzz_RTAudit::check(what)
+
+#else
+
+#define RT_AUDIT_SCOPE
+#define RT_AUDIT_CHECK(what)
+
+#endif // DOOFUZZ_RT_AUDIT
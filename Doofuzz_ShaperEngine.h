@@ -0,0 +1,436 @@
+#pragma once
+
+#include <vector>
+#include "Doofuzz_Common.h"
+#include "Doofuzz_CPU.h"
+#include "Doofuzz_Filters.h"
+#include "Doofuzz_OverSampler.h"
+#include "Doofuzz_Stereoiser.h"
+#include "Doofuzz_WaveShaper.h"
+
+using namespace Doofuzz_Common;
+
+// Everything that only depends on the sample rate, designed once per rate for all
+// instances (see SharedCache):
+struct DoofuzzCoefs {
+
+  // Designed up front, so that resets at these rates never design or block:
+  static constexpr double kCommonSampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+
+  DoofuzzCoefs(double _sampleRate);  // In Doofuzz.cpp, next to the design constants
+
+  double                            m_SampleRate;
+
+  OnePoleCoefs                      m_DCBlock;
+  BiquadCoefs                       m_Scoop;
+  Stereoiser::Coefs                 m_Stereoiser;
+  WaveShaperDoofuzz::EnvelopeCoefs  m_Envelope[int(EFactor::k16x) + 1];  // Per oversampling factor
+
+};
+
+/////////////////////////////////////////
+
+// An oversampler together with the waveshapers that run inside it. Doofuzz keeps
+// two of these, so that a change of oversampling factor can crossfade from one
+// to the other, instead of reconfiguring the one that is playing. For up to
+// MaxNumChannels channels, of which only those in use get allocated.
+template<int MaxNumChannels>
+class ShaperEngine {
+public:
+
+  // Allocates for up to _numChannels, so that reset() doesn't have to:
+  inline void reserve(int _maxBlockSize,
+                      int _numChannels) {
+    m_Oversampler.reserve(_maxBlockSize, _numChannels);
+    m_Waveshaper.reserve(_numChannels);
+    m_Env       .reserve(size_t(_maxBlockSize) * _numChannels);
+    m_EnvHistory.reserve(size_t(kEnvDelay + 2) * _numChannels);
+  }
+
+  // Only allocates for more channels than reserved (for the highest factor, and for
+  // the channels in use). Not to be called while fading:
+  inline void reset(const DoofuzzCoefs& _coefs,
+                    int                 _maxBlockSize,
+                    int                 _numChannels,
+                    EFactor             _factor) {
+    m_Oversampler.reset(_maxBlockSize, _numChannels);
+    m_Waveshaper.resize(m_Oversampler.getNumChannels());
+    m_Env       .resize(size_t(_maxBlockSize) * m_Oversampler.getNumChannels());
+    m_EnvHistory.resize(size_t(kEnvDelay + 2) * m_Oversampler.getNumChannels());
+    setOverSampling(_coefs, _factor);
+  }
+
+  // Doesn't allocate, but does clear the oversampler:
+  inline void setOverSampling(const DoofuzzCoefs& _coefs,
+                              EFactor             _factor) {
+    m_Oversampler.setOverSampling(_factor);
+    m_Oversampler.clear();
+    for (int ch = 0; ch < m_Oversampler.getNumChannels(); ch++) {
+      m_Waveshaper[ch].reset(_coefs.m_Envelope[m_EnvAtBaseRate ? 0 : int(_factor)]);
+    }
+    std::fill(m_EnvHistory.begin(), m_EnvHistory.end(), sample(0.0));
+  }
+
+  // Takes effect at the next reset() or setOverSampling():
+  inline void setEnvelopeAtBaseRate(bool _atBaseRate) {
+    m_EnvAtBaseRate = _atBaseRate;
+  }
+
+  inline bool getEnvelopeAtBaseRate() const {
+    return m_EnvAtBaseRate;
+  }
+
+  inline EFactor getFactor() const {
+    return m_Oversampler.getFactor();
+  }
+
+  inline size_t getHeapSize() const {
+    return m_Oversampler.getHeapSize() +
+           m_Waveshaper.capacity() * sizeof(WaveShaperDoofuzz) +
+           (m_Env.capacity() + m_EnvHistory.capacity()) * sizeof(sample);
+  }
+
+  // All channels in one go, in place. _rip holds the (smoothed) Rip setting per frame.
+  // Runs the variant for the CPU's instruction set level:
+  inline void process(sample*       _x,
+                      const double* _rip,
+                      int           _numFrames) {
+    (this->*m_Process)(_x, _rip, _numFrames);
+  }
+
+private:
+
+  // The kernel, compiled into each variant below:
+  DOOFUZZ_KERNEL_INLINE void processKernel(sample*       _x,
+                                           const double* _rip,
+                                           int           _numFrames) {
+
+    WaveShaperDoofuzz* waveshaper = m_Waveshaper.data();
+
+    if (m_EnvAtBaseRate && (m_Oversampler.getRate() > 1)) {
+
+      // Envelopes first, at base rate, from the signal going into the oversampler:
+
+      const int nChans  = m_Oversampler.getNumChannels();
+      sample*   env     = m_Env.data();
+
+      for (int f = 0; f < _numFrames; f++) {
+        for (int ch = 0; ch < nChans; ch++) {
+          env[f * nChans + ch] = waveshaper[ch].processEnvelope(_x[f * nChans + ch]);
+        }
+      }
+
+      // Then only the curve runs oversampled, with the envelopes interpolated
+      // between base rate frames, and delayed to line up with the upsampled signal:
+
+      const int     rate    = m_Oversampler.getRate();
+      const sample  step    = sample(1.0 / double(rate));
+      sample*       history = m_EnvHistory.data();  // [age][channel], oldest first
+
+      m_Oversampler.process(_x, _numFrames, [&](sample* os, int nChans, int nOsFrames) DOOFUZZ_LAMBDA_INLINE {
+        for (int f = 0; f < nOsFrames / rate; f++, env += nChans) {
+
+          for (int ch = 0; ch < nChans; ch++) {
+            waveshaper[ch].setRip(_rip[f]);
+          }
+
+          std::copy(history + nChans, history + (kEnvDelay + 2) * nChans, history);
+          std::copy(env, env + nChans, history + (kEnvDelay + 1) * nChans);
+
+          const sample* from  = history;
+          const sample* to    = history + nChans;
+
+          for (int i = 1; i <= rate; i++, os += nChans) {
+            for (int ch = 0; ch < nChans; ch++) {
+              os[ch] = waveshaper[ch].shape(os[ch], from[ch] + (i * step) * (to[ch] - from[ch]));
+            }
+          }
+        }
+      });
+
+    } else {
+
+      const int rate = m_Oversampler.getRate();
+
+      m_Oversampler.process(_x, _numFrames, [&](sample* os, int nChans, int nOsFrames) DOOFUZZ_LAMBDA_INLINE {
+        for (int f = 0; f < nOsFrames / rate; f++) {
+
+          for (int ch = 0; ch < nChans; ch++) {
+            waveshaper[ch].setRip(_rip[f]);
+          }
+
+          for (int i = 0; i < rate; i++, os += nChans) {
+            for (int ch = 0; ch < nChans; ch++) {
+              os[ch] = waveshaper[ch].processAudioSample(os[ch]);
+            }
+          }
+        }
+      });
+
+    }
+  }
+
+  void processBaseline(sample*        _x,
+                       const double*  _rip,
+                       int            _numFrames) {
+    processKernel(_x, _rip, _numFrames);
+  }
+
+#if DOOFUZZ_CPU_DISPATCH
+  DOOFUZZ_TARGET_AVX2
+  void processAVX2(sample*        _x,
+                   const double*  _rip,
+                   int            _numFrames) {
+    processKernel(_x, _rip, _numFrames);
+  }
+
+  DOOFUZZ_TARGET_AVX512
+  void processAVX512(sample*        _x,
+                     const double*  _rip,
+                     int            _numFrames) {
+    processKernel(_x, _rip, _numFrames);
+  }
+#endif
+
+  using ProcessFunc = void (ShaperEngine::*)(sample*, const double*, int);
+
+  static inline ProcessFunc selectProcess() {
+#if DOOFUZZ_CPU_DISPATCH
+    switch (Doofuzz_CPU::getCPULevel()) {
+      case Doofuzz_CPU::kCPUAVX512: return &ShaperEngine::processAVX512;
+      case Doofuzz_CPU::kCPUAVX2:   return &ShaperEngine::processAVX2;
+      default:                      break;
+    }
+#endif
+    return &ShaperEngine::processBaseline;
+  }
+
+  ProcessFunc                               m_Process       = selectProcess();
+
+  MultiChannelOverSampler<MaxNumChannels>   m_Oversampler   = MultiChannelOverSampler<MaxNumChannels>(EFactor::k16x);
+  std::vector<WaveShaperDoofuzz>            m_Waveshaper;  // One per channel in use
+
+  // The upsamplers delay the signal by 2 to 3 base rate frames (2x to 16x), of
+  // which the interpolation already accounts for one:
+  static const inline int                   kEnvDelay       = 2;
+
+  bool                                      m_EnvAtBaseRate = false;
+  std::vector<sample>                       m_Env;         // [frame][channel], when at base rate
+  std::vector<sample>                       m_EnvHistory;  // [age][channel], the last kEnvDelay + 2 frames
+
+};
+
+/////////////////////////////////////////
+
+// The smoothed parameters for one frame of a tile. ProcessBlock steps the smoothers
+// for the whole tile first, and the stages then pick their values from here:
+struct TileFrame {
+  double                          m_Width;
+  double                          m_Drive_Real;
+  double                          m_Active;
+  double                          m_Fade;           // Of the incoming engine, 1.0 when not fading
+  SOSCoefs<2>                     m_PostCoefs;
+};
+
+/////////////////////////////////////////
+
+// The linear filters of all channels in use, as lanes: each filter's state for all
+// channels side by side, so that a frame of the interleaved tile goes through each
+// filter step as one vector operation per 2 channels (SSE2, NEON, SIMD128), 4 (AVX2)
+// or 8 (AVX-512). The coefficients are the same for all channels. NumLanes is the
+// channel count when the layout is known at compile time, or 0 for a runtime count;
+// only those runs get the AVX2 and AVX-512 variants, as a stereo frame fills no more
+// than a baseline register.
+template<int MaxNumChannels>
+class ChannelFilters {
+public:
+
+  inline void reserve(int _numChannels) {
+    m_State.reserve(size_t(kNumStates) * _numChannels);
+  }
+
+  // Only allocates for more channels than reserved. Clears all filter states:
+  inline void reset(int _numChannels) {
+    m_NumChannels = std::clamp(_numChannels, 1, MaxNumChannels);
+    m_State.assign(size_t(kNumStates) * m_NumChannels, 0.0);
+  }
+
+  inline size_t getHeapSize() const {
+    return m_State.capacity() * sizeof(double);
+  }
+
+  // The DC blocker before the engines, times each frame's drive, in place on
+  // [frame][channel]:
+  template<int NumLanes>
+  inline void processInput(const OnePoleCoefs&  _dcBlock,
+                           const TileFrame*     _tile,
+                           sample*              _x,
+                           int                  _numFrames) {
+    if constexpr (NumLanes > 0) {
+      inputKernel<NumLanes>(_dcBlock, _tile, _x, _numFrames);
+    } else {
+      (this->*m_ProcessInput)(_dcBlock, _tile, _x, _numFrames);
+    }
+  }
+
+  // Scoop, HighCut, DCBlockAfter and Output in one go, in place on [frame][channel]:
+  template<int NumLanes>
+  inline void processOutput(const TileFrame*  _tile,
+                            sample*           _x,
+                            int               _numFrames) {
+    if constexpr (NumLanes > 0) {
+      outputKernel<NumLanes>(_tile, _x, _numFrames);
+    } else {
+      (this->*m_ProcessOutput)(_tile, _x, _numFrames);
+    }
+  }
+
+private:
+
+  // The kernels, compiled into each variant below. They work on copies of the state
+  // and coefficients, which the compiler knows not to alias the signal, with the lane
+  // loop innermost:
+
+  template<int NumLanes>
+  DOOFUZZ_KERNEL_INLINE void inputKernel(const OnePoleCoefs&  _dcBlock,
+                                         const TileFrame*     _tile,
+                                         sample*              _x,
+                                         int                  _numFrames) {
+
+    constexpr int kLanes  = (NumLanes > 0) ? NumLanes : MaxNumChannels;
+    const int     n       = (NumLanes > 0) ? NumLanes : m_NumChannels;
+
+    const OnePoleCoefs c = _dcBlock;
+
+    double dc[kLanes];
+    std::copy(m_State.data(), m_State.data() + n, dc);
+
+    for (int f = 0; f < _numFrames; f++, _x += n) {
+      const double drive = _tile[f].m_Drive_Real;
+      for (int l = 0; l < n; l++) {
+        const double in = _x[l];
+        const double y  = c.b0 * in + dc[l];
+        dc[l] = c.b1 * in - c.a1 * y;
+        _x[l] = sample(drive * y);
+      }
+    }
+
+    std::copy(dc, dc + n, m_State.data());
+  }
+
+  template<int NumLanes>
+  DOOFUZZ_KERNEL_INLINE void outputKernel(const TileFrame*  _tile,
+                                          sample*           _x,
+                                          int               _numFrames) {
+
+    constexpr int kLanes  = (NumLanes > 0) ? NumLanes : MaxNumChannels;
+    const int     n       = (NumLanes > 0) ? NumLanes : m_NumChannels;
+
+    double s1[2][kLanes];
+    double s2[2][kLanes];
+    for (int s = 0; s < 2; s++) {
+      std::copy(m_State.data() + (1 + 2*s) * n, m_State.data() + (2 + 2*s) * n, s1[s]);
+      std::copy(m_State.data() + (2 + 2*s) * n, m_State.data() + (3 + 2*s) * n, s2[s]);
+    }
+
+    for (int f = 0; f < _numFrames; f++, _x += n) {
+      const BiquadCoefs c0 = _tile[f].m_PostCoefs.section[0];
+      const BiquadCoefs c1 = _tile[f].m_PostCoefs.section[1];
+      for (int l = 0; l < n; l++) {
+        const double in = _x[l];
+        const double y0 = c0.b0 * in + s1[0][l];
+        s1[0][l] = c0.b1 * in - c0.a1 * y0 + s2[0][l];
+        s2[0][l] = c0.b2 * in - c0.a2 * y0;
+        const double y1 = c1.b0 * y0 + s1[1][l];
+        s1[1][l] = c1.b1 * y0 - c1.a1 * y1 + s2[1][l];
+        s2[1][l] = c1.b2 * y0 - c1.a2 * y1;
+        _x[l] = sample(y1);
+      }
+    }
+
+    for (int s = 0; s < 2; s++) {
+      std::copy(s1[s], s1[s] + n, m_State.data() + (1 + 2*s) * n);
+      std::copy(s2[s], s2[s] + n, m_State.data() + (2 + 2*s) * n);
+    }
+  }
+
+  void processInputBaseline(const OnePoleCoefs& _dcBlock,
+                            const TileFrame*    _tile,
+                            sample*             _x,
+                            int                 _numFrames) {
+    inputKernel<0>(_dcBlock, _tile, _x, _numFrames);
+  }
+
+  void processOutputBaseline(const TileFrame* _tile,
+                             sample*          _x,
+                             int              _numFrames) {
+    outputKernel<0>(_tile, _x, _numFrames);
+  }
+
+#if DOOFUZZ_CPU_DISPATCH
+  DOOFUZZ_TARGET_AVX2
+  void processInputAVX2(const OnePoleCoefs& _dcBlock,
+                        const TileFrame*    _tile,
+                        sample*             _x,
+                        int                 _numFrames) {
+    inputKernel<0>(_dcBlock, _tile, _x, _numFrames);
+  }
+
+  DOOFUZZ_TARGET_AVX2
+  void processOutputAVX2(const TileFrame* _tile,
+                         sample*          _x,
+                         int              _numFrames) {
+    outputKernel<0>(_tile, _x, _numFrames);
+  }
+
+  DOOFUZZ_TARGET_AVX512
+  void processInputAVX512(const OnePoleCoefs& _dcBlock,
+                          const TileFrame*    _tile,
+                          sample*             _x,
+                          int                 _numFrames) {
+    inputKernel<0>(_dcBlock, _tile, _x, _numFrames);
+  }
+
+  DOOFUZZ_TARGET_AVX512
+  void processOutputAVX512(const TileFrame* _tile,
+                           sample*          _x,
+                           int              _numFrames) {
+    outputKernel<0>(_tile, _x, _numFrames);
+  }
+#endif
+
+  using InputFunc   = void (ChannelFilters::*)(const OnePoleCoefs&, const TileFrame*, sample*, int);
+  using OutputFunc  = void (ChannelFilters::*)(const TileFrame*, sample*, int);
+
+  static inline InputFunc selectInput() {
+#if DOOFUZZ_CPU_DISPATCH
+    switch (Doofuzz_CPU::getCPULevel()) {
+      case Doofuzz_CPU::kCPUAVX512: return &ChannelFilters::processInputAVX512;
+      case Doofuzz_CPU::kCPUAVX2:   return &ChannelFilters::processInputAVX2;
+      default:                      break;
+    }
+#endif
+    return &ChannelFilters::processInputBaseline;
+  }
+
+  static inline OutputFunc selectOutput() {
+#if DOOFUZZ_CPU_DISPATCH
+    switch (Doofuzz_CPU::getCPULevel()) {
+      case Doofuzz_CPU::kCPUAVX512: return &ChannelFilters::processOutputAVX512;
+      case Doofuzz_CPU::kCPUAVX2:   return &ChannelFilters::processOutputAVX2;
+      default:                      break;
+    }
+#endif
+    return &ChannelFilters::processOutputBaseline;
+  }
+
+  // The DC blocker, and the two sections of the post filter (two states each):
+  static const inline int kNumStates      = 5;
+
+  InputFunc               m_ProcessInput  = selectInput();
+  OutputFunc              m_ProcessOutput = selectOutput();
+
+  int                     m_NumChannels   = 1;
+  std::vector<double>     m_State;        // [state][channel]: DC blocker, then s1 and s2 per post filter section
+
+};
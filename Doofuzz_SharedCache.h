@@ -0,0 +1,88 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A process-wide cache of whatever gets designed per sample rate (coefficient sets,
+// tables), shared read-only by all instances running at that rate. With a hundred
+// instances in a session, a sample rate change then designs everything once instead
+// of a hundred times, and keeps one copy of it.
+//
+// Entries are refcounted: instances hold a std::shared_ptr, the cache only a weak
+// one, so a set goes away with the last instance using it. Thread-safe, as hosts may
+// reset instances from several threads at once.
+//
+// The sets for Set::kCommonSampleRates are designed once, on the first call to
+// preload() or get(), and kept for the lifetime of the process. Getting one of those
+// takes no lock and doesn't allocate. Any other rate takes a lock, and a miss designs
+// and allocates a new set under it, so that is not for the audio thread.
+//
+// Set needs a constructor taking the sample rate, a matching m_SampleRate and a
+// kCommonSampleRates array, and must not change after construction.
+template<typename Set>
+class SharedCache {
+public:
+
+  static inline void preload() {
+    getPreloaded();
+  }
+
+  static inline std::shared_ptr<const Set> get(double _sampleRate) {
+
+    for (const auto& set: getPreloaded()) {
+      if (set->m_SampleRate == _sampleRate) {
+        return set;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(getMutex());
+
+    auto& entries = getEntries();
+
+    // Forget sets nobody uses anymore:
+    for (auto it = entries.begin(); it != entries.end(); ) {
+      if (it->second.expired()) {
+        it = entries.erase(it);
+      } else {
+        it++;
+      }
+    }
+
+    std::weak_ptr<const Set>&   entry = entries[_sampleRate];
+    std::shared_ptr<const Set>  set   = entry.lock();
+
+    if (!set) {
+      set   = std::make_shared<const Set>(_sampleRate);
+      entry = set;
+    }
+
+    return set;
+  }
+
+private:
+
+  // Read-only once initialised, and initialising a static is thread-safe:
+  static inline const std::vector<std::shared_ptr<const Set>>& getPreloaded() {
+    static const std::vector<std::shared_ptr<const Set>> preloaded = [] {
+      std::vector<std::shared_ptr<const Set>> sets;
+      for (double sampleRate: Set::kCommonSampleRates) {
+        sets.push_back(std::make_shared<const Set>(sampleRate));
+      }
+      return sets;
+    }();
+    return preloaded;
+  }
+
+  static inline std::mutex& getMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static inline std::map<double, std::weak_ptr<const Set>>& getEntries() {
+    static std::map<double, std::weak_ptr<const Set>> entries;
+    return entries;
+  }
+
+};
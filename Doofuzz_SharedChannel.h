@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+// Parameter changes and meter data between the web controller (main thread) and
+// the WAM processor (AudioWorklet) through shared memory, instead of a postMessage
+// per knob move and per meter update, each of which allocates on both sides.
+//
+// The channel lives in the processor's memory, which with DOOFUZZ_SHARED_CHANNEL
+// gets built as shared (a SharedArrayBuffer, so only on cross-origin isolated
+// pages). Each instance has its own: the processor script
+// (resources/web/Doofuzz-awp.js) looks its instance's up through
+// Doofuzz_GetSharedChannel() and posts the memory and the address to its
+// controller once, and the controller (resources/web/Doofuzz-shared-channel.js)
+// works on it with Int32Array/Float32Array views and Atomics from then on.
+// Everything in it is 32 bits wide and at a fixed offset, so that both sides agree
+// on the layout:
+//
+//   0     attached        set by the controller once it uses the channel
+//   4     paramWrite      parameter events written, by the controller
+//   8     paramRead       parameter events read, by the processor
+//   12    meterSequence   odd while the processor writes the meters
+//   16    paramEvents     kNumParamEvents x { int32 param, float32 normalised value }
+//   ...   meterValues     kNumMeterValues x float32, 0.0..1.0
+//
+// Parameter events are a single-producer single-consumer ring: the controller
+// writes the event, then bumps paramWrite; the processor reads events up to
+// paramWrite at the start of each block and then bumps paramRead. When the ring is
+// full, the controller keeps the latest value per parameter until there is room.
+// The meters are a seqlock: the controller rereads when meterSequence was odd or
+// changed while it was reading. Neither side ever waits for the other.
+//
+// Without a controller attached, the usual postMessage paths stay in use; they
+// also remain for pages that aren't cross-origin isolated (built without
+// DOOFUZZ_SHARED_CHANNEL).
+namespace Doofuzz_Shared {
+
+  static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared channel needs lock-free 32-bit atomics");
+  static_assert(sizeof(std::atomic<uint32_t>) == 4,         "Shared channel needs plain 32-bit atomics");
+
+  class Channel {
+  public:
+
+    static  const inline  uint32_t  kNumParamEvents = 256;  // A power of two
+    static  const inline  int       kNumMeterValues =   8;
+
+    struct ParamEvent {
+      int32_t m_Param;
+      float   m_Value;  // Normalised
+    };
+
+    inline bool isAttached() const {
+      return m_Attached.load(std::memory_order_acquire) != 0;
+    }
+
+    // Processor side, at the start of a block. Calls _apply(param, normalisedValue)
+    // for every event written since the last call:
+    template<typename ApplyFunc>
+    inline void readParams(ApplyFunc&& _apply) {
+
+      const uint32_t write  = m_ParamWrite.load(std::memory_order_acquire);
+      uint32_t       read   = m_ParamRead .load(std::memory_order_relaxed);
+
+      for ( ; read != write; read++) {
+        const ParamEvent& event = m_ParamEvents[read & (kNumParamEvents - 1)];
+        _apply(int(event.m_Param), double(event.m_Value));
+      }
+
+      m_ParamRead.store(read, std::memory_order_release);
+    }
+
+    // Processor side; never blocks:
+    inline void writeMeters(const float* _values,
+                            int          _numValues) {
+
+      const uint32_t sequence = m_MeterSequence.load(std::memory_order_relaxed);
+
+      m_MeterSequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      for (int v = 0; (v < _numValues) && (v < kNumMeterValues); v++) {
+        m_MeterValues[v] = _values[v];
+      }
+
+      m_MeterSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+  private:
+
+    std::atomic<uint32_t> m_Attached      { 0 };
+    std::atomic<uint32_t> m_ParamWrite    { 0 };
+    std::atomic<uint32_t> m_ParamRead     { 0 };
+    std::atomic<uint32_t> m_MeterSequence { 0 };
+    ParamEvent            m_ParamEvents   [kNumParamEvents] = {};
+    float                 m_MeterValues   [kNumMeterValues] = {};
+
+  };
+
+  static_assert(std::is_standard_layout<Channel>::value, "Shared channel layout is fixed");
+  static_assert(sizeof(Channel) == 16 + Channel::kNumParamEvents * 8 + Channel::kNumMeterValues * 4,
+                "Shared channel layout is fixed");
+
+};
@@ -2,28 +2,47 @@
 
 #include <limits>
 #include "iir1/Iir.h"
+#include "Doofuzz_Filters.h"
 
 class Stereoiser {
+private:
+
+  static  const inline  int     kNumNotches       =  7;
+
 public:
 
-  Stereoiser() {
-    reset(48000.0);
-  }
+  // Designed once per sample rate, and shared:
+  struct Coefs {
+    BiquadLaneCoefs<2>          m_Notch[kNumNotches];     // Lanes are channels
+    OnePoleCoefs                m_HighPass;
+    OnePoleCoefs                m_LowPass;
+  };
 
-  inline double reset(const double _sampleRate) {
+  static inline Coefs design(const double _sampleRate) {
 
-    m_HighPass.setup(_sampleRate, kHighPassF);
-    m_LowPass .setup(_sampleRate, kLowPassF );
+    Coefs coefs;
+
+    // Inverted, like the iir1 high-pass this replaces; the stereo image depends on it:
+    coefs.m_HighPass = OnePoleCoefs::highPass(_sampleRate, kHighPassF).scale(-1.0);
+    coefs.m_LowPass  = OnePoleCoefs::lowPass (_sampleRate, kLowPassF );
 
     double notchFreq = 4000.0 * kSqrtPhi;
 
+    Iir::RBJ::IIRNotch design;  // Design-time only
+
     for (int n = 0; n < kNumNotches; n++) {
       for (int ch = 0; ch < 2; ch++) {
-        m_Notch[ch][n].setup(_sampleRate, notchFreq /= kSqrtPhi, kNotchQ);
+        design.setup(_sampleRate, notchFreq /= kSqrtPhi, kNotchQ);
+        coefs.m_Notch[n].setup(ch, BiquadCoefs::fromIir(design));
       }
     };
 
-    return _sampleRate;
+    return coefs;
+  }
+
+  // _coefs has to outlive this:
+  inline void reset(const Coefs& _coefs) {
+    m_Coefs = &_coefs;
   }
 
   inline double setWidth(double _width) {                   // 0.0..1.0; the stored and used
@@ -48,15 +67,13 @@ public:
       double processed[2] = { inputL, inputR };
 
       for (int n = 0; n < kNumNotches; n++) {
-        for (int ch = 0; ch < 2; ch++) {
-          processed[ch] = m_Notch[ch][n].filter(processed[ch]);
-        }
+        m_Notch[n].process(m_Coefs->m_Notch[n], processed);  // Both channels at once
       }
 
       double processedCombinedAndFiltered = kWidthMultiplier *
                                               m_WidthSquared *
-                                                m_LowPass.filter(
-                                                  m_HighPass.filter(
+                                                m_LowPass.process(m_Coefs->m_LowPass,
+                                                  m_HighPass.process(m_Coefs->m_HighPass,
                                                     processed[0] - processed[1]));
 
       *outputL  = inputL + processedCombinedAndFiltered; // inputL;
@@ -73,7 +90,6 @@ private:
   static  const inline  double  kHighPassF        =  250.0;
   static  const inline  double  kLowPassF         = 4000.0;
 
-  static  const inline  int     kNumNotches       =  7;
   static  const inline  double  kNotchQ           = 10.0;
   static  const inline  double  kPhi              = (sqrt(5.0) + 1.0) / 2.0;
   static  const inline  double  kSqrtPhi          = sqrt(kPhi);
@@ -82,8 +98,9 @@ private:
 
   double                        m_WidthSquared    = 1.0;
 
-  Iir::RBJ::IIRNotch            m_Notch[2][kNumNotches];  // channels, notches
-  Iir::Butterworth::HighPass<1> m_HighPass;
-  Iir::Butterworth::LowPass <1> m_LowPass;
+  const Coefs*                  m_Coefs           = nullptr;
+  BiquadLanes<2>                m_Notch[kNumNotches];     // Lanes are channels
+  OnePole                       m_HighPass;
+  OnePole                       m_LowPass;
 
 };
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Oversampler.h"  // For EFactor
+
+#ifdef _WIN32
+  #include <process.h>
+  #define DOOFUZZ_GETPID _getpid
+#else
+  #include <unistd.h>
+  #define DOOFUZZ_GETPID getpid
+#endif
+
+using namespace iplug;
+
+// Per-instance performance statistics, for finding out which instances on a machine
+// overrun, rather than only that the host dropped out.
+//
+// Every instance keeps running statistics of its ProcessBlock calls: block count,
+// mean, 99th percentile and maximum time, deadline overruns (blocks that took longer
+// than the audio they produced), denormal-suspect blocks (near-silent input, yet much
+// slower than usual, the typical sign of filter tails decaying into denormals), and
+// the audio time spent at each oversampling factor. The audio thread only does
+// relaxed atomic stores into memory of its own, so recording never blocks.
+//
+// Publishing is off unless the environment variable DOOFUZZ_TELEMETRY_DIR names a
+// directory. Then one background thread per process rewrites
+// <dir>/doofuzz-<pid>-<n>.json for every live instance every kPublishIntervalS, and
+// removes an instance's file when it goes away. All the file I/O is on that thread,
+// outside its lock: instances only add or drop a reference to their statistics, so
+// creating and destroying them never waits on the disk. scripts/telemetry_report.py
+// aggregates all of them on a machine.
+namespace Doofuzz_Telemetry {
+
+  const double  kPublishIntervalS = 2.0;
+  const int     kNumTimeBuckets   = 64;      // Quarter octaves from 1 us up to 65 ms
+  const double  kSuspectSilence   = 1.0e-5;  // Input peak (-100 dBFS) ...
+  const double  kSuspectSlowdown  = 3.0;     // ... and this much slower per frame than usual
+
+  // Read once; nullptr when publishing is off:
+  inline const char* getDirectory() {
+    static const char* directory = [] {
+      const char* dir = std::getenv("DOOFUZZ_TELEMETRY_DIR");
+      return (dir && *dir) ? dir : nullptr;
+    }();
+    return directory;
+  }
+
+  // One instance's statistics. Written by its audio thread only, read by the
+  // publisher at any time; shared with it, so that it can finish publishing them
+  // after the instance has gone:
+  struct Statistics {
+
+    std::string           m_ID;
+
+    std::atomic<uint64_t> m_Blocks            { 0 };
+    std::atomic<uint64_t> m_Frames            { 0 };
+    std::atomic<uint64_t> m_TotalNs           { 0 };
+    std::atomic<uint64_t> m_MaxNs             { 0 };
+    std::atomic<uint64_t> m_Overruns          { 0 };
+    std::atomic<uint64_t> m_DenormalSuspects  { 0 };
+    std::atomic<uint64_t> m_FramesAtFactor    [int(EFactor::kNumFactors)] = {};
+    std::atomic<uint32_t> m_TimeHistogram     [kNumTimeBuckets]           = {};
+    std::atomic<double>   m_SampleRate        { 0.0 };
+    std::atomic<int>      m_NumChannels       { 0 };
+
+    double                m_MeanNsPerFrame    = 0.0;  // Audio thread only
+
+    // From the publisher thread:
+    std::string toJSON() const;
+
+  };
+
+  // An instance's handle on its statistics:
+  class Recorder {
+  public:
+
+    Recorder();
+    ~Recorder();
+
+    Recorder(const Recorder&)             = delete;
+    Recorder& operator=(const Recorder&)  = delete;
+
+    inline bool isEnabled() const {
+      return bool(m_Statistics);
+    }
+
+    inline size_t getHeapSize() const {
+      return isEnabled() ? sizeof(Statistics) : 0;
+    }
+
+    // At the end of every block, from the audio thread:
+    inline void recordBlock(double  _seconds,
+                            int     _nFrames,
+                            double  _sampleRate,
+                            int     _nChannels,
+                            EFactor _factor,
+                            double  _inputPeak) {
+
+      Statistics&     stats = *m_Statistics;
+      const uint64_t  ns    = uint64_t(std::max(0.0, _seconds) * 1.0e9);
+
+      bump(stats.m_Blocks,  1);
+      bump(stats.m_Frames,  uint64_t(_nFrames));
+      bump(stats.m_TotalNs, ns);
+      bump(stats.m_FramesAtFactor[int(_factor)], uint64_t(_nFrames));
+
+      if (ns > stats.m_MaxNs.load(std::memory_order_relaxed)) {
+        stats.m_MaxNs.store(ns, std::memory_order_relaxed);
+      }
+
+      const int bucket = std::clamp(int(4.0 * std::log2(std::max(1.0, double(ns) / 1000.0))), 0, kNumTimeBuckets - 1);
+      bump(stats.m_TimeHistogram[bucket], 1);
+
+      if (_nFrames > 0) {
+
+        if (_seconds * _sampleRate > _nFrames) {
+          bump(stats.m_Overruns, 1);
+        }
+
+        const double nsPerFrame = double(ns) / _nFrames;
+
+        if ((_inputPeak < kSuspectSilence) && (stats.m_MeanNsPerFrame > 0.0) && (nsPerFrame > kSuspectSlowdown * stats.m_MeanNsPerFrame)) {
+          bump(stats.m_DenormalSuspects, 1);
+        } else {
+          // Suspects stay out of the average, so that a long stretch of them keeps counting:
+          stats.m_MeanNsPerFrame += ((stats.m_MeanNsPerFrame > 0.0) ? 0.01 : 1.0) * (nsPerFrame - stats.m_MeanNsPerFrame);
+        }
+      }
+
+      stats.m_SampleRate.store(_sampleRate, std::memory_order_relaxed);
+      stats.m_NumChannels.store(_nChannels, std::memory_order_relaxed);
+    }
+
+  private:
+
+    // Single writer, so a load and a store will do; cheaper than an atomic add:
+    template<typename T>
+    static inline void bump(std::atomic<T>&                     _counter,
+                            typename std::atomic<T>::value_type _amount) {
+      _counter.store(_counter.load(std::memory_order_relaxed) + _amount, std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<Statistics> m_Statistics;  // Null when publishing is off
+
+  };
+
+  // The process-wide publisher thread, running while there are instances to publish
+  // or files to remove:
+  class Publisher {
+  public:
+
+    static inline Publisher& get() {
+      static Publisher publisher;
+      return publisher;
+    }
+
+    inline void add(const std::shared_ptr<const Statistics>& _statistics) {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Live.push_back(_statistics);
+      if (!m_Running) {
+        // A thread that stopped has nothing left to do but return:
+        if (m_Thread.joinable()) {
+          m_Thread.join();
+        }
+        m_Running = true;
+        m_Thread  = std::thread([this] { run(); });
+      }
+    }
+
+    // The file goes on the publisher thread, after any publishing of it in progress:
+    inline void remove(const std::shared_ptr<const Statistics>& _statistics) {
+      {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Live.erase(std::remove(m_Live.begin(), m_Live.end(), _statistics), m_Live.end());
+        m_Removed.push_back(_statistics);
+      }
+      m_Wake.notify_all();
+    }
+
+    static inline std::string getPath(const Statistics& _statistics) {
+      return std::string(getDirectory()) + "/doofuzz-" + _statistics.m_ID + ".json";
+    }
+
+  private:
+
+    ~Publisher() {
+      {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+      }
+      m_Wake.notify_all();
+      if (m_Thread.joinable()) {
+        m_Thread.join();
+      }
+    }
+
+    // Works on copies of the lists, so that the lock is only held to take them;
+    // stops once both are empty, or at exit, after removing the files of the
+    // instances that have gone:
+    inline void run() {
+
+      using Clock = std::chrono::steady_clock;
+
+      const auto                    interval  = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(kPublishIntervalS));
+      std::unique_lock<std::mutex>  lock(m_Mutex);
+      Clock::time_point             due       = Clock::now() + interval;
+
+      while (!m_Live.empty() || !m_Removed.empty()) {
+
+        m_Wake.wait_until(lock, due, [&] { return m_Stopping || !m_Removed.empty(); });
+
+        std::vector<std::shared_ptr<const Statistics>> live;
+        std::vector<std::shared_ptr<const Statistics>> removed;
+        if (!m_Stopping && (Clock::now() >= due)) {
+          live  = m_Live;
+          due  += interval;
+        }
+        removed.swap(m_Removed);
+
+        lock.unlock();
+        for (const auto& statistics: live) {
+          publish(*statistics);
+        }
+        for (const auto& statistics: removed) {
+          std::remove(getPath(*statistics).c_str());
+        }
+        lock.lock();
+
+        if (m_Stopping) {
+          break;
+        }
+      }
+
+      m_Running = false;
+    }
+
+    // Written next to the file and then renamed over it, so that readers never see
+    // half a file:
+    static inline void publish(const Statistics& _statistics) {
+
+      const std::string path      = getPath(_statistics);
+      const std::string tempPath  = path + ".tmp";
+      const std::string json      = _statistics.toJSON();
+
+      if (FILE* file = std::fopen(tempPath.c_str(), "w")) {
+        std::fputs(json.c_str(), file);
+        std::fclose(file);
+#ifdef _WIN32
+        std::remove(path.c_str());  // rename() doesn't replace there
+#endif
+        std::rename(tempPath.c_str(), path.c_str());
+      }
+    }
+
+    std::mutex                                      m_Mutex;
+    std::condition_variable                         m_Wake;
+    std::thread                                     m_Thread;
+    bool                                            m_Running   = false;
+    bool                                            m_Stopping  = false;
+    std::vector<std::shared_ptr<const Statistics>>  m_Live;
+    std::vector<std::shared_ptr<const Statistics>>  m_Removed;
+
+  };
+
+  inline Recorder::Recorder() {
+
+    if (getDirectory() != nullptr) {
+      static std::atomic<int> numInstances { 0 };
+      m_Statistics        = std::make_shared<Statistics>();
+      m_Statistics->m_ID  = std::to_string(int(DOOFUZZ_GETPID())) + "-" + std::to_string(++numInstances);
+      Publisher::get().add(m_Statistics);
+    }
+  }
+
+  inline Recorder::~Recorder() {
+    if (m_Statistics) {
+      Publisher::get().remove(m_Statistics);
+    }
+  }
+
+  inline std::string Statistics::toJSON() const {
+
+    static const char* const kFactorNames[int(EFactor::kNumFactors)] = { "1x", "2x", "4x", "8x", "16x" };
+
+    const uint64_t blocks     = m_Blocks.load(std::memory_order_relaxed);
+    const double   sampleRate = m_SampleRate.load(std::memory_order_relaxed);
+
+    // The 99th percentile, as the upper edge of the bucket it falls in:
+    uint64_t counts = 0;
+    int      p99    = 0;
+    for ( ; p99 < kNumTimeBuckets - 1; p99++) {
+      counts += m_TimeHistogram[p99].load(std::memory_order_relaxed);
+      if (counts * 100 >= blocks * 99) {
+        break;
+      }
+    }
+
+    char buffer[1024];
+    int  length = std::snprintf(buffer, sizeof(buffer),
+                                "{\n"
+                                "  \"id\": \"%s\",\n"
+                                "  \"sampleRate\": %.0f,\n"
+                                "  \"channels\": %d,\n"
+                                "  \"blocks\": %llu,\n"
+                                "  \"frames\": %llu,\n"
+                                "  \"meanUs\": %.2f,\n"
+                                "  \"p99Us\": %.2f,\n"
+                                "  \"maxUs\": %.2f,\n"
+                                "  \"overruns\": %llu,\n"
+                                "  \"denormalSuspects\": %llu,\n"
+                                "  \"secondsAtFactor\": {",
+                                m_ID.c_str(),
+                                sampleRate,
+                                m_NumChannels.load(std::memory_order_relaxed),
+                                (unsigned long long)blocks,
+                                (unsigned long long)m_Frames.load(std::memory_order_relaxed),
+                                (blocks > 0) ? m_TotalNs.load(std::memory_order_relaxed) / 1000.0 / blocks : 0.0,
+                                (blocks > 0) ? std::exp2((p99 + 1) / 4.0) : 0.0,
+                                m_MaxNs.load(std::memory_order_relaxed) / 1000.0,
+                                (unsigned long long)m_Overruns.load(std::memory_order_relaxed),
+                                (unsigned long long)m_DenormalSuspects.load(std::memory_order_relaxed));
+
+    for (int f = 0; f < int(EFactor::kNumFactors); f++) {
+      const double seconds = (sampleRate > 0.0) ? m_FramesAtFactor[f].load(std::memory_order_relaxed) / sampleRate : 0.0;
+      length += std::snprintf(buffer + length, sizeof(buffer) - length,
+                              "%s \"%s\": %.3f", (f > 0) ? "," : "", kFactorNames[f], seconds);
+    }
+
+    std::snprintf(buffer + length, sizeof(buffer) - length, " }\n}\n");
+
+    return std::string(buffer);
+  }
+
+};
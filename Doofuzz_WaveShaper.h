@@ -1,46 +1,75 @@
 #pragma once
 
 #include  "Doofuzz_Common.h"
-#include  "iir1/Iir.h"
-#include  "iir1/iir/Butterworth.h"
+#include  "Doofuzz_CPU.h"
+#include  "Doofuzz_Filters.h"
 
 using namespace Doofuzz_Common;
 
 class WaveShaperDoofuzz {
+  private:
+
+  static const inline int     kNumEnvFollowers  = 4;
+
   public:
 
-  inline double reset(const double _sampleRate) {
+  // Like the oversampler, in sample precision (float in the web build):
+  using EnvelopeCoefs = OnePoleLaneCoefs<kNumEnvFollowers, sample>;
+
+  // For the rate the envelope runs at. Designed once per rate, and shared:
+  static inline EnvelopeCoefs designEnvelope(const double _sampleRate) {
+    EnvelopeCoefs coefs;
     for (int i = 0; i < kNumEnvFollowers; i++) {
-      envelopeFollower[i].setup(_sampleRate, envFollowerFreq[i]);
+      coefs.setup(i, OnePoleCoefs::lowPass(_sampleRate, envFollowerFreq[i]));
     }
-    return _sampleRate;
+    return coefs;
+  }
+
+  // _envCoefs has to outlive this:
+  inline void reset(const EnvelopeCoefs& _envCoefs) {
+    m_EnvCoefs = &_envCoefs;
+  }
+
+  inline sample setRip(const double _rip) {
+    return m_Rip = sample(_rip);
   }
 
-  inline double setRip(const double _rip) {
-    return m_Rip = _rip;
+  DOOFUZZ_KERNEL_INLINE sample processAudioSample(sample _sample) {
+    return shape(_sample, processEnvelope(_sample));
   }
 
-  inline double processAudioSample(double _sample) {
+  // The two halves of processAudioSample(), for when the envelope runs at a lower
+  // rate than the curve:
+
+  DOOFUZZ_KERNEL_INLINE sample processEnvelope(sample _sample) {
 
-    double sample2 = _sample * _sample;
+    sample sample2 = _sample * _sample;
 
     // Calculate minimum envelope level:
-    double env = envelopeFollower[0].filter(sample2);
+    sample envs[kNumEnvFollowers];
+    envelopeFollowers.process(*m_EnvCoefs, sample2, envs);
+
+    sample env = envs[0];
     for (int i = 1; i < kNumEnvFollowers; i++) {
-      env = std::min(env, envelopeFollower[i].filter(sample2));
+      env = std::min(env, envs[i]);
     }
 
-    _sample += m_Rip * sqrt(2.0 * kRippingAmount * env);
+    return env;
+  }
 
-    return tanh(_sample * (1.0 + _sample * _sample / 3.0));
+  DOOFUZZ_KERNEL_INLINE sample shape(sample _sample,
+                                     sample _env) {
+
+    _sample += m_Rip * sqrt(sample(2.0 * kRippingAmount) * _env);
+
+    return tanh(_sample * (sample(1.0) + _sample * _sample / sample(3.0)));
   }
 
 private:
 
   static const inline double  kRippingAmount    = 1.25;
-  static const inline int     kNumEnvFollowers  = 4;
 
-  double envFollowerFreq[kNumEnvFollowers] = {
+  static constexpr double envFollowerFreq[kNumEnvFollowers] = {
     40.0,
     // 80.0,
     160.0,
@@ -51,8 +80,8 @@ private:
     // 5120.0,
   };
 
-  double                        m_SampleRate  = 48000.0;
-  double                        m_Rip         =     0.5;
-  Iir::Butterworth::LowPass<1>  envelopeFollower[kNumEnvFollowers];
+  sample                                  m_Rip         =     0.5;
+  const EnvelopeCoefs*                    m_EnvCoefs    = nullptr;
+  OnePoleLanes<kNumEnvFollowers, sample>  envelopeFollowers;
 
 };
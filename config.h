@@ -16,7 +16,7 @@
 
 #define SHARED_RESOURCES_SUBPATH  "Doofuzz"
 
-#define PLUG_CHANNEL_IO           "1-1 1-2 2-2"
+#define PLUG_CHANNEL_IO           "1-1 1-2 2-2 6-6 8-8 12-12"  // Up to 7.1.4
 
 #define PLUG_LATENCY              0
 #define PLUG_TYPE                 0
@@ -37,8 +37,8 @@
 #define AUV2_VIEW_CLASS           Doofuzz_View
 #define AUV2_VIEW_CLASS_STR       "Doofuzz_View"
 
-#define AAX_TYPE_IDS              'IEF1', 'IEF2'
-#define AAX_TYPE_IDS_AUDIOSUITE   'IEA1', 'IEA2'
+#define AAX_TYPE_IDS              'IEF1', 'IEF2', 'IEF3', 'IEF4', 'IEF5'
+#define AAX_TYPE_IDS_AUDIOSUITE   'IEA1', 'IEA2', 'IEA3', 'IEA4', 'IEA5'
 #define AAX_PLUG_MFR_STR          "ShamelessPlugs"
 #define AAX_PLUG_NAME_STR         "Doofuzz\nIPEF"
 #define AAX_PLUG_CATEGORY_STR     "Effect"
@@ -8,7 +8,32 @@ SRC += $(PROJECT_ROOT)/Doofuzz.cpp
 
 # WAM_SRC +=
 
-# WAM_CFLAGS +=
+# The DSP side (the WAM processor) runs in float, as the AudioWorklet hands over
+# float buffers anyway; the oversampler and shaper then run in float too (see
+# Doofuzz_OverSampler.h). Set DOOFUZZ_WEB_FLOAT=0 for the double chain of the
+# native builds:
+DOOFUZZ_WEB_FLOAT ?= 1
+ifeq ($(DOOFUZZ_WEB_FLOAT), 1)
+WAM_CFLAGS += -DSAMPLE_TYPE_FLOAT
+endif
+
+# WebAssembly SIMD128, so that the compiler vectorises the kernels across
+# channels. Supported by all current browsers; a module can't check for it at
+# runtime, so DOOFUZZ_WASM_SIMD=0 builds the scalar fallback for older ones:
+DOOFUZZ_WASM_SIMD ?= 1
+ifeq ($(DOOFUZZ_WASM_SIMD), 1)
+WAM_CFLAGS += -msimd128
+endif
+
+# Parameter events and meters through shared memory instead of postMessage (see
+# Doofuzz_SharedChannel.h). The processor's memory then becomes a
+# SharedArrayBuffer, which needs a cross-origin isolated page (COOP/COEP headers),
+# so this is off by default; without it, everything goes through postMessage:
+DOOFUZZ_SHARED_CHANNEL ?= 0
+ifeq ($(DOOFUZZ_SHARED_CHANNEL), 1)
+WAM_CFLAGS += -DDOOFUZZ_SHARED_CHANNEL -sSHARED_MEMORY=1
+WAM_LDFLAGS += -sSHARED_MEMORY=1
+endif
 
 WEB_CFLAGS += -DIGRAPHICS_NANOVG -DIGRAPHICS_GLES2
 
@@ -0,0 +1,26 @@
+// The WAM processor of Doofuzz: iPlug2's template one, plus handing this instance's
+// shared channel (see Doofuzz_SharedChannel.h) over to its controller, when the
+// module was built with DOOFUZZ_SHARED_CHANNEL and its memory is shared.
+// makedist-web.sh uses this instead of the template.
+
+class DoofuzzAWP extends AudioWorkletGlobalScope.WAMProcessor
+{
+  constructor(options) {
+    options = options || {}
+    options.mod = AudioWorkletGlobalScope.WAM.Doofuzz;
+    super(options);
+
+    const WAM     = options.mod;
+    const memory  = WAM.wasmMemory ? WAM.wasmMemory.buffer : (WAM.HEAPU8 ? WAM.HEAPU8.buffer : null);
+
+    if (WAM._Doofuzz_GetSharedChannel && (typeof SharedArrayBuffer !== "undefined") && (memory instanceof SharedArrayBuffer)) {
+      // this.inst is this processor's instance, as createModule() returned it:
+      const address = WAM._Doofuzz_GetSharedChannel(this.inst);
+      if (address) {
+        this.port.postMessage({ type: "doofuzzSharedChannel", buffer: memory, address: address });
+      }
+    }
+  }
+}
+
+registerProcessor("Doofuzz", DoofuzzAWP);
@@ -0,0 +1,187 @@
+// The controller side of Doofuzz's shared channel (see Doofuzz_SharedChannel.h for
+// the layout). Loaded after Doofuzz-awn.js, this replaces DoofuzzController with a
+// subclass that, once its processor has handed over a channel, writes parameter
+// changes into the channel instead of posting them, and reads the meters from it
+// once per animation frame. Nothing gets allocated per change or per frame.
+//
+// Processors only hand over a channel when built with DOOFUZZ_SHARED_CHANNEL on a
+// cross-origin isolated page; otherwise nothing changes, and everything keeps going
+// through postMessage.
+
+const kDoofuzzChannel = {
+  // Offsets, in 32-bit words:
+  attached:         0,
+  paramWrite:       1,
+  paramRead:        2,
+  meterSequence:    3,
+  paramEvents:      4,    // kNumParamEvents x { int32 param, float32 value }
+  meterValues:      516,  // paramEvents + 2 * kNumParamEvents
+  length:           524,  // meterValues + kNumMeterValues
+
+  numParamEvents:   256,
+  numMeterValues:   8,
+};
+
+// The meters, as the processor writes them: control tag (ECtrlTags in Doofuzz.h),
+// first value, number of values:
+const kDoofuzzMeters = [
+  [ 1, 0, 2 ],  // Input: peak and RMS
+  [ 2, 2, 2 ],  // Output: peak and RMS
+  [ 3, 4, 1 ],  // Gain reduction
+];
+
+const kDoofuzzMeterMinMove  = 0.004;  // Of a meter's height, before it's worth a redraw
+const kDoofuzzMeterRetries  = 4;      // Reads per frame that may collide with the processor's writes
+
+class DoofuzzSharedChannel {
+
+  constructor(buffer, address) {
+    // Two views of the same words, for the int and float fields:
+    this.ints     = new Int32Array(buffer, address, kDoofuzzChannel.length);
+    this.floats   = new Float32Array(buffer, address, kDoofuzzChannel.length);
+
+    this.pending  = new Map();  // Latest value per parameter, while the ring is full
+    this.meters   = new Float32Array(kDoofuzzChannel.numMeterValues);
+    this.shown    = new Float32Array(kDoofuzzChannel.numMeterValues).fill(-1.0);
+    this.sequence = -1;
+    this.message  = 0;          // ISenderData for the UI module, allocated on first use
+
+    Atomics.store(this.ints, kDoofuzzChannel.attached, 1);
+  }
+
+  // A normalised parameter value. When the ring is full, it waits in this.pending,
+  // where a later value for the same parameter replaces it:
+  setParam(param, value) {
+    this.pending.delete(param);
+    this.flush();
+    if ((this.pending.size > 0) || !this.push(param, value)) {
+      this.pending.set(param, value);
+    }
+  }
+
+  // Once per animation frame:
+  update() {
+    this.flush();
+    if (this.readMeters()) {
+      this.showMeters();
+    }
+  }
+
+  push(param, value) {
+    const write = Atomics.load(this.ints, kDoofuzzChannel.paramWrite);
+    const read  = Atomics.load(this.ints, kDoofuzzChannel.paramRead);
+
+    if (((write - read) >>> 0) >= kDoofuzzChannel.numParamEvents) {
+      return false;
+    }
+
+    const event = kDoofuzzChannel.paramEvents + 2 * (write & (kDoofuzzChannel.numParamEvents - 1));
+    this.ints  [event    ] = param;
+    this.floats[event + 1] = value;
+
+    Atomics.store(this.ints, kDoofuzzChannel.paramWrite, (write + 1) | 0);  // Publishes the event
+    return true;
+  }
+
+  flush() {
+    for (const [param, value] of this.pending) {
+      if (!this.push(param, value)) {
+        return;
+      }
+      this.pending.delete(param);
+    }
+  }
+
+  // True when there are new values; a read that overlapped a write gets retried:
+  readMeters() {
+    for (let tries = 0; tries < kDoofuzzMeterRetries; tries++) {
+
+      const before = Atomics.load(this.ints, kDoofuzzChannel.meterSequence);
+      if (before & 1) {
+        continue;
+      }
+      if (before === this.sequence) {
+        return false;
+      }
+
+      for (let v = 0; v < kDoofuzzChannel.numMeterValues; v++) {
+        this.meters[v] = this.floats[kDoofuzzChannel.meterValues + v];
+      }
+
+      if (Atomics.load(this.ints, kDoofuzzChannel.meterSequence) === before) {
+        this.sequence = before;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Into the meter controls of the UI module, the way an ISender would deliver them
+  // (ISenderData: int ctrlTag, int nChans, int chanOffset, float vals[nChans]), but
+  // only the meters that visibly moved:
+  showMeters() {
+    if ((typeof Module === "undefined") || !Module.SCMFD) {
+      return;
+    }
+
+    if (!this.message) {
+      this.message = Module._malloc(4 * 5);
+    }
+
+    for (const [tag, first, count] of kDoofuzzMeters) {
+
+      let moved = false;
+      for (let v = first; v < first + count; v++) {
+        moved = moved || (Math.abs(this.meters[v] - this.shown[v]) >= kDoofuzzMeterMinMove);
+      }
+      if (!moved) {
+        continue;
+      }
+
+      const word = this.message >> 2;
+      Module.HEAP32[word    ] = tag;
+      Module.HEAP32[word + 1] = count;
+      Module.HEAP32[word + 2] = 0;
+      for (let v = 0; v < count; v++) {
+        Module.HEAPF32[word + 3 + v] = this.shown[first + v] = this.meters[first + v];
+      }
+
+      Module.SCMFD(tag, 0 /* ISender::kUpdateMessage */, 4 * (3 + count), this.message);
+    }
+  }
+
+}
+
+if (typeof DoofuzzController !== "undefined") {
+
+  DoofuzzController = class extends DoofuzzController {
+
+    constructor(actx, options) {
+      super(actx, options);
+
+      this.sharedChannel = null;
+
+      this.port.addEventListener("message", (e) => {
+        if (e.data && (e.data.type === "doofuzzSharedChannel") && !this.sharedChannel) {
+          this.sharedChannel = new DoofuzzSharedChannel(e.data.buffer, e.data.address);
+          const tick = () => {
+            this.sharedChannel.update();
+            requestAnimationFrame(tick);
+          };
+          requestAnimationFrame(tick);
+        }
+      });
+    }
+
+    setParam(key, value) {
+      const param = Number(key);
+      if (this.sharedChannel && Number.isInteger(param)) {
+        this.sharedChannel.setParam(param, value);
+      } else {
+        super.setParam(key, value);
+      }
+    }
+
+  };
+
+}
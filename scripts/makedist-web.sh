@@ -132,6 +132,11 @@ if [ "$WEBSOCKET_MODE" -eq "0" ]; then
   # replace ORIGIN_PLACEHOLDER in the template -awn.js script
   sed -i.bak s,ORIGIN_PLACEHOLDER,$SITE_ORIGIN,g $PROJECT_NAME-awn.js
 
+  # our own processor script, which hands the shared channel over to the controller, and the controller side of it
+  # (see Doofuzz_SharedChannel.h); both do nothing unless built with DOOFUZZ_SHARED_CHANNEL=1
+  cp $PROJECT_ROOT/resources/web/$PROJECT_NAME-awp.js $PROJECT_NAME-awp.js
+  cp $PROJECT_ROOT/resources/web/$PROJECT_NAME-shared-channel.js $PROJECT_NAME-shared-channel.js
+
   rm *.bak
 else
   echo "WAM not being built in websocket mode"
@@ -155,6 +160,9 @@ if [ $WEBSOCKET_MODE -eq "1" ]; then
 else
   sed -i.bak s/'<script src="scripts\/websocket.js"><\/script>'/'<!--<script src="scripts\/websocket.js"><\/script>-->'/g index.html;
 
+  # load the shared channel's controller side right after the controller class it extends
+  sed -i.bak "s,<script[^>]*scripts/$PROJECT_NAME-awn.js[^>]*></script>,&<script src=\"scripts/$PROJECT_NAME-shared-channel.js\"></script>,g" index.html;
+
   # update the i/o details for the AudioWorkletNodeOptions parameter, based on config.h channel io str
   MAXNINPUTS=$(python3 $IPLUG2_ROOT/Scripts/parse_iostr.py "$PROJECT_ROOT" inputs)
   MAXNOUTPUTS=$(python3 $IPLUG2_ROOT/Scripts/parse_iostr.py "$PROJECT_ROOT" outputs)
@@ -0,0 +1,59 @@
+#!/usr/bin/python3
+
+# this script aggregates the performance telemetry of all Doofuzz instances on this machine.
+# instances publish it when the host runs with DOOFUZZ_TELEMETRY_DIR set (see Doofuzz_Telemetry.h)
+
+import glob, json, os, sys, time
+
+STALE_SECONDS = 10.0  # instances publish every 2 seconds; older files belong to crashed processes
+
+def main():
+  if len(sys.argv) > 2:
+    print("Usage: telemetry_report.py [telemetry directory, default $DOOFUZZ_TELEMETRY_DIR]")
+    sys.exit(1)
+
+  directory = sys.argv[1] if len(sys.argv) == 2 else os.environ.get("DOOFUZZ_TELEMETRY_DIR", "")
+
+  if not directory or not os.path.isdir(directory):
+    print("No telemetry directory; pass one, or set DOOFUZZ_TELEMETRY_DIR")
+    sys.exit(1)
+
+  now = time.time()
+  instances = []
+
+  for path in glob.glob(os.path.join(directory, "doofuzz-*.json")):
+    try:
+      if now - os.path.getmtime(path) > STALE_SECONDS:
+        continue
+      with open(path) as f:
+        instances.append(json.load(f))
+    except (OSError, ValueError):
+      continue  # went away, or is being replaced
+
+  if not instances:
+    print("No live instances in " + directory)
+    return
+
+  # worst first: overruns, then p99
+  instances.sort(key=lambda i: (i["overruns"], i["p99Us"]), reverse=True)
+
+  print("%-14s %6s %3s %10s %9s %9s %9s %9s %9s  %s" % ("instance", "rate", "ch", "blocks", "mean us", "p99 us", "max us",
+                                                        "overruns", "denormal", "seconds at 1x/2x/4x/8x/16x"))
+
+  for i in instances:
+    factors = "/".join("%.0f" % s for s in i["secondsAtFactor"].values())
+    print("%-14s %6.0f %3d %10d %9.1f %9.1f %9.1f %9d %9d  %s" % (i["id"], i["sampleRate"], i["channels"], i["blocks"],
+                                                                  i["meanUs"], i["p99Us"], i["maxUs"],
+                                                                  i["overruns"], i["denormalSuspects"], factors))
+
+  blocks = sum(i["blocks"] for i in instances)
+  overruns = sum(i["overruns"] for i in instances)
+  suspects = sum(i["denormalSuspects"] for i in instances)
+  overrunning = sum(1 for i in instances if i["overruns"] > 0)
+
+  print("")
+  print("%d instance(s), %d overrunning; %d of %d blocks overran, %d denormal-suspect" % (len(instances), overrunning,
+                                                                                         overruns, blocks, suspects))
+
+if __name__ == '__main__':
+  main()
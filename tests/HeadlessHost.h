@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// The whole plugin goes into the one translation unit of each test: Doofuzz.h
+// defines its parameter tables, so it can't be shared between two:
+#include "Doofuzz.cpp"
+
+// One Doofuzz instance, hosted the way a plugin host would, minus the plugin API:
+// the rate, block size and channels get set before OnReset(), parameters through
+// OnParamChange(), and audio through ProcessBlock(). The input is low-level noise,
+// so that every stage has something to do.
+class HeadlessHost {
+public:
+
+  HeadlessHost(double _sampleRate,
+               int    _maxBlockSize,
+               int    _nInChans,
+               int    _nOutChans,
+               bool   _inPlace = false) :
+    m_Plugin    (new Doofuzz(InstanceInfo())),
+    m_NumIn     (_nInChans),
+    m_NumOut    (_nOutChans),
+    m_InPlace   (_inPlace),
+    m_Buffers   (size_t(std::max(_nInChans, _nOutChans)) * 2 * std::max(_maxBlockSize, 1)) {
+
+    const int maxBlock = std::max(_maxBlockSize, 1);
+
+    for (int ch = 0; ch < m_NumIn; ch++) {
+      m_Inputs.push_back(&m_Buffers[size_t(ch) * maxBlock]);
+    }
+    for (int ch = 0; ch < m_NumOut; ch++) {
+      m_Outputs.push_back(m_InPlace ? &m_Buffers[size_t(ch) * maxBlock]  // Hosts may hand over the same buffers
+                                    : &m_Buffers[size_t(m_NumOut + ch) * maxBlock]);
+    }
+
+    m_Plugin->SetSampleRate(_sampleRate);
+    m_Plugin->SetBlockSize(_maxBlockSize);
+    m_Plugin->SetChannelConnections(kInput,  0, m_NumIn,  true);
+    m_Plugin->SetChannelConnections(kOutput, 0, m_NumOut, true);
+  }
+
+  Doofuzz& plugin() {
+    return *m_Plugin;
+  }
+
+  void reset() {
+    m_Plugin->OnReset();
+  }
+
+  void setParam(int    _param,
+                double _value) {
+    m_Plugin->GetParam(_param)->Set(_value);
+    m_Plugin->OnParamChange(_param);
+  }
+
+  void process(int _nFrames) {
+    for (int ch = 0; ch < m_NumIn; ch++) {
+      for (int f = 0; f < _nFrames; f++) {
+        m_Seed = m_Seed * 1664525u + 1013904223u;
+        m_Inputs[ch][f] = sample(0.25 * (double(m_Seed >> 8) / double(1 << 24) - 0.5));
+      }
+    }
+    m_Plugin->ProcessBlock(m_Inputs.data(), m_Outputs.data(), _nFrames);
+  }
+
+  const sample* output(int _channel) const {
+    return m_Outputs[_channel];
+  }
+
+private:
+
+  std::unique_ptr<Doofuzz>  m_Plugin;
+  int                       m_NumIn;
+  int                       m_NumOut;
+  bool                      m_InPlace;
+  std::vector<sample>       m_Buffers;
+  std::vector<sample*>      m_Inputs;
+  std::vector<sample*>      m_Outputs;
+  uint32_t                  m_Seed      = 1;
+
+};
+
+inline double microsecondsSince(std::chrono::steady_clock::time_point _start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start).count();
+}
@@ -0,0 +1,55 @@
+// Big-session benchmark: N instances (default 256) in one process, each processing
+// one block in turn, the way a host runs a large session, so that every instance's
+// state has to come back into the caches at every block. Compared with one instance
+// processing the same number of blocks on its own (state always cached), this shows
+// how much time goes to cache misses. Usage: cache_stress_bench [N] [blocks per instance]
+
+#include <cstdio>
+#include "HeadlessHost.h"
+
+static double timeBlocks(std::vector<std::unique_ptr<HeadlessHost>>& _hosts,
+                         int                                         _numInstances,
+                         int                                         _blocksPerInstance,
+                         int                                         _blockSize) {
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int b = 0; b < _blocksPerInstance; b++) {
+    for (int i = 0; i < _numInstances; i++) {
+      _hosts[i]->process(_blockSize);
+    }
+  }
+  return microsecondsSince(start) / (double(_numInstances) * _blocksPerInstance);
+}
+
+int main(int argc, char** argv) {
+
+  const int     numInstances      = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 256;
+  const int     blocksPerInstance = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 40;
+  const double  sampleRate        = 48000.0;
+  const int     blockSize         = 128;
+
+  for (bool oversampling: { false, true }) {
+
+    std::vector<std::unique_ptr<HeadlessHost>> hosts;
+    for (int i = 0; i < numInstances; i++) {
+      hosts.emplace_back(new HeadlessHost(sampleRate, blockSize, 2, 2));
+      hosts.back()->plugin().GetParam(kParamOversampling)->Set(oversampling);
+      hosts.back()->reset();
+    }
+
+    // Warm up, then time one instance on its own, then all in turn:
+    timeBlocks(hosts, numInstances, 2, blockSize);
+    const double aloneUs    = timeBlocks(hosts, 1, blocksPerInstance * numInstances, blockSize);
+    const double sessionUs  = timeBlocks(hosts, numInstances, blocksPerInstance, blockSize);
+    const double budgetUs   = 1.0e6 * blockSize / sampleRate;
+
+    std::printf("cache_stress_bench (%s): %d instances x %d blocks of %d frames, oversampling %s: "
+                "%.2f us per block alone, %.2f us in the session (x%.2f), "
+                "session load %.1f%% of one core; %d bytes per instance object\n",
+                Doofuzz_CPU::kCPULevelNames[Doofuzz_CPU::getCPULevel()], numInstances, blocksPerInstance, blockSize,
+                oversampling ? "16x" : "none", aloneUs, sessionUs, sessionUs / aloneUs,
+                100.0 * sessionUs * numInstances / budgetUs, int(sizeof(Doofuzz)));
+  }
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+// Equivalence of the hot-path filter kernels (Doofuzz_Filters.h) with the iir1
+// filters they replaced, on noise, at the rates the plugin runs them at (up to 16x
+// oversampled for the envelope followers). Includes the polarity assumptions: iir1's
+// first-order high-pass inverts, the DC blockers relied on negating it, and the
+// Stereoiser relies on the inversion. Needs the real iir1 (the submodule).
+
+#include <cstdio>
+#include <functional>
+#include "IPlug_include_in_plug_hdr.h"
+
+using namespace iplug;  // As in Doofuzz.h, which the DSP headers are included from
+
+#include "Doofuzz_Filters.h"
+#include "Doofuzz_Stereoiser.h"
+
+static const double kTolerance  = 1.0e-9;  // On input of up to +/-1.0
+static const int    kNumFrames  = 20000;
+static const double kRates[]    = { 44100.0, 48000.0, 96000.0, 192000.0, 705600.0, 768000.0 };
+
+static int gNumFailures = 0;
+
+// Maximum difference between two filters fed the same noise; fails when it's
+// above (or, for _mustDiffer, not above) the tolerance:
+static double compare(const char*                    _what,
+                      double                         _sampleRate,
+                      std::function<double(double)>  _reference,
+                      std::function<double(double)>  _kernel,
+                      bool                           _mustDiffer = false) {
+
+  uint32_t  seed    = 32;
+  double    maxDiff = 0.0;
+
+  for (int f = 0; f < kNumFrames; f++) {
+    seed = seed * 1664525u + 1013904223u;
+    const double x = 2.0 * (double(seed >> 8) / double(1 << 24)) - 1.0;
+    const double reference = _reference(x);  // Before the kernel, which may depend on it
+    maxDiff = std::max(maxDiff, std::fabs(reference - _kernel(x)));
+  }
+
+  if ((maxDiff > kTolerance) != _mustDiffer) {
+    std::printf("FAILED: %s at %.0f Hz: max difference %g\n", _what, _sampleRate, maxDiff);
+    gNumFailures++;
+  }
+  return maxDiff;
+}
+
+// The Stereoiser as it was with iir1 filters:
+class ReferenceStereoiser {
+public:
+
+  ReferenceStereoiser(double _sampleRate,
+                      double _width) :
+    m_WidthSquared(_width * _width) {
+
+    m_HighPass.setup(_sampleRate, kHighPassF);
+    m_LowPass .setup(_sampleRate, kLowPassF );
+
+    double notchFreq = 4000.0 * kSqrtPhi;
+    for (int n = 0; n < kNumNotches; n++) {
+      for (int ch = 0; ch < 2; ch++) {
+        m_Notch[ch][n].setup(_sampleRate, notchFreq /= kSqrtPhi, kNotchQ);
+      }
+    }
+  }
+
+  void processFrame(double  _inputL,
+                    double  _inputR,
+                    double* _outputL,
+                    double* _outputR) {
+
+    double processed[2] = { _inputL, _inputR };
+    for (int n = 0; n < kNumNotches; n++) {
+      for (int ch = 0; ch < 2; ch++) {
+        processed[ch] = m_Notch[ch][n].filter(processed[ch]);
+      }
+    }
+
+    const double side = kWidthMultiplier * m_WidthSquared * m_LowPass.filter(m_HighPass.filter(processed[0] - processed[1]));
+
+    *_outputL = _inputL + side;
+    *_outputR = _inputR - side;
+  }
+
+private:
+
+  static  const inline  double  kHighPassF        =  250.0;
+  static  const inline  double  kLowPassF         = 4000.0;
+  static  const inline  int     kNumNotches       =  7;
+  static  const inline  double  kNotchQ           = 10.0;
+  static  const inline  double  kSqrtPhi          = sqrt((sqrt(5.0) + 1.0) / 2.0);
+  static  const inline  double  kWidthMultiplier  = 2.0;
+
+  double                        m_WidthSquared;
+  Iir::RBJ::IIRNotch            m_Notch[2][kNumNotches];
+  Iir::Butterworth::HighPass<1> m_HighPass;
+  Iir::Butterworth::LowPass <1> m_LowPass;
+
+};
+
+int main() {
+
+  double worst = 0.0;
+
+  for (double sr: kRates) {
+
+    // First-order low-pass (high-cut, Stereoiser, envelope followers), on its own and as lanes:
+    for (double cutoff: { 20.0, 250.0, 4000.0, 12000.0, 20000.0 }) {
+      if (cutoff >= 0.45 * sr) {
+        continue;
+      }
+      Iir::Butterworth::LowPass<1> reference;
+      reference.setup(sr, cutoff);
+      const OnePoleCoefs coefs = OnePoleCoefs::lowPass(sr, cutoff);
+      OnePole kernel;
+      worst = std::max(worst, compare("low-pass", sr,
+                                      [&](double x) { return reference.filter(x); },
+                                      [&](double x) { return kernel.process(coefs, x); }));
+    }
+
+    {
+      const double        cutoffs[4] = { 5.0, 50.0, 500.0, 5000.0 };
+      OnePoleLaneCoefs<4> coefs;
+      for (int l = 0; l < 4; l++) {
+        coefs.setup(l, OnePoleCoefs::lowPass(sr, cutoffs[l]));
+      }
+      for (int l = 0; l < 4; l++) {
+        // Each lane against its reference, all lanes running:
+        Iir::Butterworth::LowPass<1> reference;
+        reference.setup(sr, cutoffs[l]);
+        OnePoleLanes<4> lanes;
+        worst = std::max(worst, compare("low-pass lanes", sr,
+                                        [&](double x) { return reference.filter(x); },
+                                        [&](double x) { double y[4]; lanes.process(coefs, x, y); return y[l]; }));
+      }
+    }
+
+    // First-order high-pass: iir1's inverts, ours doesn't. The DC blockers used to
+    // negate iir1's output, so ours matches that; the Stereoiser used it as it was,
+    // so it scales ours by -1:
+    for (double cutoff: { 40.0, 250.0 }) {
+      Iir::Butterworth::HighPass<1> reference;
+      reference.setup(sr, cutoff);
+      OnePole kernel;
+      const OnePoleCoefs coefs = OnePoleCoefs::highPass(sr, cutoff);
+      worst = std::max(worst, compare("high-pass, negated iir1 (DC blockers)", sr,
+                                      [&](double x) { return -reference.filter(x); },
+                                      [&](double x) { return kernel.process(coefs, x); }));
+
+      reference.reset();
+      kernel.reset();
+      compare("high-pass polarity (iir1 has to invert)", sr,
+              [&](double x) { return reference.filter(x); },
+              [&](double x) { return kernel.process(coefs, x); },
+              true);
+
+      reference.reset();
+      kernel.reset();
+      OnePoleCoefs inverted = OnePoleCoefs::highPass(sr, cutoff);
+      inverted.scale(-1.0);
+      worst = std::max(worst, compare("high-pass, inverted like iir1 (Stereoiser)", sr,
+                                      [&](double x) { return reference.filter(x); },
+                                      [&](double x) { return kernel.process(inverted, x); }));
+    }
+
+    // Notches, as a cascade and as lanes:
+    {
+      Iir::RBJ::IIRNotch  reference[7];
+      SOSCoefs<7>         coefs;
+      BiquadLaneCoefs<2>  laneCoefs[7];
+      double              freq = 4000.0;
+      for (int n = 0; n < 7; n++, freq /= 1.272) {
+        reference[n].setup(sr, freq, 10.0);
+        coefs.section[n] = BiquadCoefs::fromIir(reference[n]);
+        laneCoefs[n].setup(0, coefs.section[n]);
+        laneCoefs[n].setup(1, coefs.section[n]);
+      }
+      SOSCascade<7> cascade;
+      worst = std::max(worst, compare("notch cascade", sr,
+                                      [&](double x) { for (auto& r: reference) { x = r.filter(x); } return x; },
+                                      [&](double x) { return cascade.process(coefs, x); }));
+
+      for (auto& r: reference) {
+        r.reset();
+      }
+      BiquadLanes<2> lanes[7];
+      worst = std::max(worst, compare("notch lanes", sr,
+                                      [&](double x) { for (auto& r: reference) { x = r.filter(x); } return x; },
+                                      [&](double x) {
+                                        double y[2] = { x, -x };
+                                        for (int n = 0; n < 7; n++) {
+                                          lanes[n].process(laneCoefs[n], y);
+                                        }
+                                        return 0.5 * (y[0] - y[1]);
+                                      }));
+    }
+
+    // The scoop, and the post filter it's fused into: scoop, high-cut, then the
+    // negated DC blocker, times the output gain, in two second-order sections:
+    {
+      Iir::RBJ::BandShelf           scoop;
+      Iir::Butterworth::LowPass<1>  highCut;
+      Iir::Butterworth::HighPass<1> dcBlock;
+      scoop  .setup(sr, 432.0, -24.0, 2.4);
+      highCut.setup(sr, 4000.0);
+      dcBlock.setup(sr, 40.0);
+
+      SOSCoefs<1>   scoopCoefs;
+      SOSCascade<1> scoopKernel;
+      scoopCoefs.section[0] = BiquadCoefs::fromIir(scoop);
+      worst = std::max(worst, compare("band shelf", sr,
+                                      [&](double x) { return scoop.filter(x); },
+                                      [&](double x) { return scoopKernel.process(scoopCoefs, x); }));
+
+      scoop.reset();
+      const double  gain = 0.3;
+      SOSCoefs<2>   postCoefs;
+      SOSCascade<2> post;
+      postCoefs.section[0] = BiquadCoefs::fromIir(scoop);
+      postCoefs.section[1] = BiquadCoefs::fromFirstOrders(OnePoleCoefs::lowPass(sr, 4000.0), OnePoleCoefs::highPass(sr, 40.0)).scale(gain);
+      worst = std::max(worst, compare("post filter", sr,
+                                      [&](double x) { return gain * -dcBlock.filter(highCut.filter(scoop.filter(x))); },
+                                      [&](double x) { return post.process(postCoefs, x); }));
+    }
+
+    // The whole Stereoiser, side channel included:
+    if (sr <= 192000.0) {
+      ReferenceStereoiser         reference(sr, 0.7);
+      const Stereoiser::Coefs     coefs = Stereoiser::design(sr);
+      Stereoiser                  kernel;
+      kernel.reset(coefs);
+      kernel.setWidth(0.7);
+      double previous = 0.0;
+      worst = std::max(worst, compare("Stereoiser", sr,
+                                      [&](double x) { double l, r; reference.processFrame(x, previous, &l, &r); return l - r; },
+                                      [&](double x) {
+                                        sample l, r;
+                                        kernel.processFrame(sample(x), sample(previous), &l, &r);
+                                        previous = x;  // Right is left, one frame late
+                                        return double(l) - double(r);
+                                      }));
+    }
+
+  }
+
+  std::printf("filters_vs_iir1: %s, largest difference %g\n", (gNumFailures == 0) ? "all equivalent" : "FAILED", worst);
+  return (gNumFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <initializer_list>
+#include <vector>
+
+// Headless: enough of IGraphics for the layout code to compile. MakeGraphics()
+// returns nullptr, so none of it ever runs.
+
+namespace iplug {
+namespace igraphics {
+
+  struct IColor {
+    IColor WithOpacity(float) const { return *this; }
+  };
+
+  static const IColor COLOR_BLACK, COLOR_WHITE, COLOR_GRAY, COLOR_MID_GRAY, COLOR_DARK_GRAY, COLOR_LIGHT_GRAY,
+                      COLOR_RED, COLOR_GREEN, COLOR_ORANGE, COLOR_TRANSLUCENT;
+
+  struct IRECT {
+    float L = 0.0f, T = 0.0f, R = 0.0f, B = 0.0f;
+
+    IRECT() {}
+    IRECT(float _l, float _t, float _r, float _b) : L(_l), T(_t), R(_r), B(_b) {}
+
+    float W() const { return R - L; }
+    float H() const { return B - T; }
+
+    IRECT GetFromBRHC(float, float)   const { return *this; }
+    IRECT GetPadded(float)            const { return *this; }
+    IRECT GetFromTop(float)           const { return *this; }
+    IRECT GetFromBottom(float)        const { return *this; }
+    IRECT GetReducedFromTop(float)    const { return *this; }
+    IRECT GetHShifted(float)          const { return *this; }
+    IRECT GetVShifted(float)          const { return *this; }
+  };
+
+  struct IText      { IText(float = 14.0f) {} };
+  struct IMouseMod  {};
+
+  enum class ECursor    { ARROW, HAND, SIZENWSE };
+  enum class EBlend     { Default };
+  enum class EVShape    { Rectangle, Ellipse };
+  enum class EDirection { Vertical, Horizontal };
+
+  struct IBlend { IBlend(EBlend = EBlend::Default, float = 1.0f) {} };
+
+  struct IVStyle {
+    IVStyle WithDrawFrame(bool)     const { return *this; }
+    IVStyle WithDrawShadows(bool)   const { return *this; }
+    IVStyle WithValueText(IText)    const { return *this; }
+    IVStyle WithLabelText(IText)    const { return *this; }
+    IVStyle WithShowLabel(bool)     const { return *this; }
+    IVStyle WithShowValue(bool)     const { return *this; }
+  };
+
+  static const IVStyle DEFAULT_STYLE;
+
+  class IGraphics;
+
+  class IControl {
+  public:
+    template<class... Args> IControl(Args&&...) {}
+    virtual ~IControl() {}
+
+    virtual void Draw(IGraphics&) {}
+    virtual void OnMouseDown(float, float, const IMouseMod&) {}
+    virtual void OnMouseDblClick(float, float, const IMouseMod&) {}
+    virtual void OnMouseOver(float, float, const IMouseMod&) {}
+    virtual void OnMouseOut() {}
+    virtual void OnMsgFromDelegate(int, int, const void*) {}
+
+    IControl*   SetTooltip(const char*)         { return this; }
+    void        SetBlend(IBlend)                {}
+    void        SetDirty(bool = true, int = -1) {}
+    void        SetDisabled(bool)               {}
+    void        SetValue(double, int = 0)       {}
+    void        SetStr(const char*)             {}
+    double      GetValue(int = 0)         const { return 0.0; }
+    int         GetParamIdx()             const { return 0; }
+    int         GetTag()                  const { return 0; }
+    bool        GetMouseIsOver()          const { return false; }
+    bool        IsHidden()                const { return false; }
+    IGraphics*  GetUI()                         { return nullptr; }
+    template<class T> T* As()                   { return static_cast<T*>(this); }
+
+    IRECT mRECT;
+  };
+
+  class ICornerResizerControl : public IControl {
+  public:
+    ICornerResizerControl(IRECT, float, IColor, IColor, IColor) {}
+
+    float   mSize = 0.0f;
+    IRECT   mInitialGraphicsBounds;
+    IColor  mColor, mMouseOverColor, mDragColor;
+  };
+
+#define HEADLESS_CONTROL(name) class name : public IControl { public: template<class... Args> name(Args&&...) {} };
+  HEADLESS_CONTROL(IVKnobControl)
+  HEADLESS_CONTROL(IVToggleControl)
+  HEADLESS_CONTROL(IVButtonControl)
+  HEADLESS_CONTROL(IVLabelControl)
+  HEADLESS_CONTROL(IURLControl)
+  HEADLESS_CONTROL(ITextControl)
+#undef HEADLESS_CONTROL
+
+  template<int MAXNC = 1>
+  class IVMeterControl : public IControl {
+  public:
+    IVMeterControl(const IRECT&, const char*, const IVStyle& = IVStyle(), EDirection = EDirection::Vertical,
+                   std::initializer_list<const char*> = {}, int = 0) {}
+  };
+
+  class IVTabSwitchControl : public IControl {
+  public:
+    IVTabSwitchControl(const IRECT&, int, const std::vector<const char*>&, const char*, const IVStyle&, EVShape, EDirection) {}
+  };
+
+  class IGraphics {
+  public:
+    void        EnableMouseOver(bool)                                 {}
+    void        EnableTooltips(bool)                                  {}
+    void        AttachCornerResizer(IControl*)                        {}
+    void        AttachPanelBackground(IColor)                         {}
+    IControl*   AttachControl(IControl* _control, int = -1, const char* = "") { return _control; }
+    bool        LoadFont(const char*, const char*)                    { return true; }
+    int         NControls()                                     const { return 0; }
+    IControl*   GetControl(int)                                       { return nullptr; }
+    IControl*   GetControlWithTag(int)                                { return nullptr; }
+    IRECT       GetBounds()                                     const { return IRECT(); }
+    void        Resize(float, float, float)                           {}
+    ECursor     SetMouseCursor(ECursor _cursor)                       { return _cursor; }
+    bool        GetResizingInProcess()                          const { return false; }
+    void        FillTriangle(const IColor&, float, float, float, float, float, float) {}
+    void        FillRect(const IColor&, const IRECT&)                 {}
+    void        DrawRect(const IColor&, const IRECT&)                 {}
+    void        DrawText(const IText&, const char*, const IRECT&)     {}
+  };
+
+  template<class Delegate, class... Args>
+  inline IGraphics* MakeGraphics(Delegate&, Args...) {
+    return nullptr;
+  }
+
+  inline float GetScaleForScreen(int, int) {
+    return 1.0f;
+  }
+
+};
+};
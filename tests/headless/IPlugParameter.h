@@ -0,0 +1,3 @@
+#pragma once
+
+#include "IPlug_include_in_plug_hdr.h"
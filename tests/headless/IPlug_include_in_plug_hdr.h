@@ -0,0 +1,144 @@
+#pragma once
+
+// Headless stand-in for the parts of iPlug2 that Doofuzz uses, so that the tests
+// and benchmarks in tests/ can construct, reset and run instances without a plugin
+// API, an audio device or a UI. The host side is iPlug's own: SetSampleRate(),
+// SetBlockSize() and SetChannelConnections() before OnReset(), then ProcessBlock().
+// Parameters are linear only; nothing here gets exercised for its display.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+#include "config.h"
+
+namespace iplug {
+
+#ifdef SAMPLE_TYPE_FLOAT
+  typedef float  sample;
+#else
+  typedef double sample;
+#endif
+
+#define DBGMSG(...) std::fprintf(stderr, __VA_ARGS__)
+
+  inline double DBToAmp(double _dB)  { return std::exp(0.11512925464970228420089957273422 * _dB); }
+  inline double AmpToDB(double _amp) { return 8.685889638065036553 * std::log(_amp); }
+
+  enum ERoute { kInput = 0, kOutput = 1 };
+
+  struct InstanceInfo {};
+
+  struct Config {
+    int nParams;
+    int nPresets;
+  };
+
+  inline Config MakeConfig(int _nParams, int _nPresets) {
+    return { _nParams, _nPresets };
+  }
+
+  class IParam {
+  public:
+
+    enum EDisplayType { kDisplayLinear, kDisplayLog, kDisplayExp };
+
+    void InitDouble   (const char*, double _def, double _min, double _max, double = 0.001) { init(_def, _min, _max); }
+    void InitGain     (const char*, double _def, double _min, double _max, double = 0.1)   { init(_def, _min, _max); }
+    void InitFrequency(const char*, double _def, double _min, double _max, double = 1.0)   { init(_def, _min, _max); mDisplayType = kDisplayLog; }
+    void InitBool     (const char*, bool _def)                                              { init(_def, 0.0, 1.0); }
+    void InitEnum     (const char*, int _def, const std::initializer_list<const char*>& _names, int = 0, const char* = "") {
+      init(_def, 0.0, double(_names.size()) - 1.0);
+    }
+
+    double        Value()         const { return mValue; }
+    double        GetMin()        const { return mMin; }
+    double        GetMax()        const { return mMax; }
+    double        GetDefault()    const { return mDefault; }
+    EDisplayType  DisplayType()   const { return mDisplayType; }
+    double        ToNormalized(double _value) const { return (mMax > mMin) ? (_value - mMin) / (mMax - mMin) : 0.0; }
+    double        GetNormalized() const { return ToNormalized(mValue); }
+
+    void Set(double _value)           { mValue = std::clamp(_value, mMin, mMax); }
+    void SetNormalized(double _value) { Set(mMin + _value * (mMax - mMin)); }
+
+  private:
+
+    void init(double _def, double _min, double _max) {
+      mDefault = mValue = _def;
+      mMin = _min;
+      mMax = _max;
+    }
+
+    double        mValue        = 0.0;
+    double        mDefault      = 0.0;
+    double        mMin          = 0.0;
+    double        mMax          = 1.0;
+    EDisplayType  mDisplayType  = kDisplayLinear;
+  };
+
+  namespace igraphics { class IGraphics; }
+
+  class IEditorDelegate {
+  public:
+    void SendControlMsgFromDelegate(int, int, int, const void*) {}
+    void SendControlValueFromDelegate(int, double) {}
+  };
+
+  // Only there for the web build's Doofuzz_GetSharedChannel():
+  namespace WAM { class Processor { public: virtual ~Processor() {} }; }
+
+  class Plugin : public IEditorDelegate, public WAM::Processor {
+  public:
+
+    Plugin(const InstanceInfo&, Config _config) :
+      mParams(_config.nParams) {}
+
+    virtual ~Plugin() {}
+
+    // The host:
+    void SetSampleRate(double _sampleRate)  { mSampleRate = _sampleRate; }
+    void SetBlockSize(int _blockSize)       { mBlockSize  = _blockSize; }
+    void SetChannelConnections(ERoute _direction, int, int _n, bool _connected) {
+      (_direction == kInput ? mNInChans : mNOutChans) = _connected ? _n : 0;
+    }
+
+    double  GetSampleRate()     const { return mSampleRate; }
+    int     GetBlockSize()      const { return mBlockSize; }
+    int     NParams()           const { return int(mParams.size()); }
+    IParam* GetParam(int _idx)        { return &mParams[_idx]; }
+    int     NInChansConnected() const { return mNInChans; }
+    int     NOutChansConnected()const { return mNOutChans; }
+    void    SetTailSize(int)          {}
+    void    SetLatency(int)           {}
+
+    igraphics::IGraphics* GetUI() { return nullptr; }
+
+    virtual void OnReset() {}
+    virtual void OnParamChange(int) {}
+    virtual void OnIdle() {}
+    virtual void ProcessBlock(sample**, sample**, int) {}
+
+  protected:
+
+    std::function<igraphics::IGraphics*()>     mMakeGraphicsFunc;
+    std::function<void(igraphics::IGraphics*)> mLayoutFunc;
+
+  private:
+
+    std::vector<IParam> mParams;
+    double              mSampleRate = 44100.0;
+    int                 mBlockSize  = 512;
+    int                 mNInChans   = 2;
+    int                 mNOutChans  = 2;
+  };
+
+};
+
+#include "IControl.h"
@@ -0,0 +1,3 @@
+#pragma once
+
+// Headless: no plugin API entry points (see IPlug_include_in_plug_hdr.h).
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+
+// Headless: the queue from the audio thread to the UI, without a UI to go to.
+
+namespace iplug {
+
+  const int kNoTag = -1;
+
+  template<int MAXNC = 1, typename T = float>
+  struct ISenderData {
+    int               ctrlTag     = kNoTag;
+    int               nChans      = MAXNC;
+    int               chanOffset  = 0;
+    std::array<T, MAXNC> vals {};
+
+    ISenderData() {}
+    ISenderData(int _ctrlTag, int _nChans, int _chanOffset) :
+      ctrlTag(_ctrlTag), nChans(_nChans), chanOffset(_chanOffset) {}
+  };
+
+  template<int MAXNC = 1, int QUEUE_SIZE = 64, typename T = float>
+  class ISender {
+  public:
+
+    static constexpr int kUpdateMessage = 0;
+
+    void PushData(const ISenderData<MAXNC, T>& _data) {
+      if (mCount < QUEUE_SIZE) {
+        mQueue[mCount++] = _data;
+      }
+    }
+
+    template<class Delegate>
+    void TransmitData(Delegate& _delegate) {
+      for (int i = 0; i < mCount; i++) {
+        _delegate.SendControlMsgFromDelegate(mQueue[i].ctrlTag, kUpdateMessage, int(sizeof(mQueue[i])), &mQueue[i]);
+      }
+      mCount = 0;
+    }
+
+  private:
+
+    std::array<ISenderData<MAXNC, T>, QUEUE_SIZE> mQueue;
+    int                                           mCount = 0;
+  };
+
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+// Headless: Doofuzz has its own oversampler, and only needs iPlug's factors.
+
+namespace iplug {
+
+  enum EFactor {
+    kNone = 0,
+    k2x,
+    k4x,
+    k8x,
+    k16x,
+    kNumFactors
+  };
+
+};
@@ -0,0 +1,52 @@
+// Session-load benchmark: what a host does for every instance when it loads a
+// session, timed per phase over N instances (default 256) and averaged. Construction
+// includes the shared coefficient preload; the first reset allocates for the channels
+// in use, and the second is the one hosts do at transport changes, which doesn't.
+// Usage: instantiation_bench [N]
+
+#include <cstdio>
+#include "HeadlessHost.h"
+
+int main(int argc, char** argv) {
+
+  const int     numInstances  = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 256;
+  const double  sampleRate    = 48000.0;
+  const int     blockSize     = 512;
+
+  std::vector<std::unique_ptr<HeadlessHost>> hosts;
+  hosts.reserve(numInstances);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numInstances; i++) {
+    hosts.emplace_back(new HeadlessHost(sampleRate, blockSize, 2, 2));
+  }
+  const double constructUs = microsecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (auto& host: hosts) {
+    host->reset();
+  }
+  const double resetUs = microsecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (auto& host: hosts) {
+    host->process(blockSize);
+  }
+  const double firstBlockUs = microsecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (auto& host: hosts) {
+    host->reset();
+  }
+  const double secondResetUs = microsecondsSince(start);
+
+  const double totalUs = constructUs + resetUs + firstBlockUs;
+
+  std::printf("instantiation_bench (%s): %d instances; per instance: construct %.1f us, reset %.1f us, first block %.1f us, "
+              "total %.1f us; second reset %.1f us\n",
+              Doofuzz_CPU::kCPULevelNames[Doofuzz_CPU::getCPULevel()], numInstances,
+              constructUs / numInstances, resetUs / numInstances, firstBlockUs / numInstances,
+              totalUs / numInstances, secondResetUs / numInstances);
+
+  return 0;
+}
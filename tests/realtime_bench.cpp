@@ -0,0 +1,53 @@
+// Realtime factor of one stereo instance at 48 kHz, in AudioWorklet-sized blocks
+// of 128 frames, without and with 16x oversampling (the latter also with the rip
+// envelope at base rate): seconds of audio processed per second of wall time. Runs
+// natively, and under Node when built with Emscripten (make web-bench), to compare
+// the web build's float/SIMD128 variants without a browser.
+// Usage: realtime_bench [seconds of audio]
+
+#include <cstdio>
+#include "HeadlessHost.h"
+
+int main(int argc, char** argv) {
+
+  const double  seconds     = (argc > 1) ? std::max(0.1, std::atof(argv[1])) : 10.0;
+  const double  sampleRate  = 48000.0;
+  const int     blockSize   = 128;
+  const int     numBlocks   = int(seconds * sampleRate / blockSize);
+
+#if defined(__wasm_simd128__)
+  const char* build = "wasm simd128";
+#elif defined(__EMSCRIPTEN__)
+  const char* build = "wasm scalar";
+#else
+  const char* build = Doofuzz_CPU::kCPULevelNames[Doofuzz_CPU::getCPULevel()];
+#endif
+
+  for (int run = 0; run < 3; run++) {
+
+    const bool  oversampling  = (run != 0);
+    const bool  envAtBaseRate = (run == 2);
+
+    HeadlessHost host(sampleRate, blockSize, 2, 2);
+    host.plugin().GetParam(kParamOversampling)->Set(oversampling);
+    host.plugin().setEnvelopeAtBaseRate(envAtBaseRate);
+    host.reset();
+
+    for (int b = 0; b < 50; b++) {
+      host.process(blockSize);  // Warm-up
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < numBlocks; b++) {
+      host.process(blockSize);
+    }
+    const double wallSeconds = microsecondsSince(start) / 1.0e6;
+
+    std::printf("realtime_bench (%s, %s): oversampling %s%s, %.1fx realtime (%.2f us per %d-frame block)\n",
+                build, (sizeof(sample) == sizeof(float)) ? "float" : "double", oversampling ? "16x" : "none",
+                envAtBaseRate ? ", envelope at base rate" : "",
+                numBlocks * blockSize / sampleRate / wallSeconds, 1.0e6 * wallSeconds / numBlocks, blockSize);
+  }
+
+  return 0;
+}
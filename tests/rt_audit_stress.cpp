@@ -0,0 +1,231 @@
+// Real-time-safety stress test (see Doofuzz_RTAudit.h): built with DOOFUZZ_RT_AUDIT,
+// and with the C library's allocators, locks, sleeps and file writes wrapped by the
+// linker (see the Makefile), so that any of them inside ProcessBlock aborts, whoever
+// calls them. Checks first that each wrapper does catch its call. Then sweeps every
+// parameter over its range, every oversampling mode (auto included) and Active
+// on and off, across sample rates, block sizes (empty blocks included) and channel
+// layouts, with random automation on top, and the rip envelope both oversampled and
+// at base rate (also switched while playing), with telemetry publishing. Exits
+// non-zero on a violation, or on output that isn't finite.
+
+#include <csignal>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "HeadlessHost.h"
+
+#ifndef DOOFUZZ_RT_AUDIT
+  #error "Build with -DDOOFUZZ_RT_AUDIT; without it, violations go unnoticed"
+#endif
+
+// The wrappers, for everything linked into this executable (Doofuzz.cpp included,
+// and whatever the standard headers inline into it). Calls from inside the shared
+// C and C++ libraries aren't wrapped, which is why the audit replaces operator new
+// as well:
+extern "C" {
+
+#define RT_AUDIT_WRAP(ret, name, params, args)              \
+  ret __real_##name params;                                 \
+  ret __wrap_##name params {                                \
+    Doofuzz_RTAudit::check(#name);                          \
+    return __real_##name args;                              \
+  }
+
+RT_AUDIT_WRAP(void*,  malloc,                 (size_t _size),                                   (_size))
+RT_AUDIT_WRAP(void*,  calloc,                 (size_t _count, size_t _size),                    (_count, _size))
+RT_AUDIT_WRAP(void*,  realloc,                (void* _ptr, size_t _size),                       (_ptr, _size))
+RT_AUDIT_WRAP(void*,  aligned_alloc,          (size_t _alignment, size_t _size),                (_alignment, _size))
+RT_AUDIT_WRAP(int,    posix_memalign,         (void** _ptr, size_t _alignment, size_t _size),   (_ptr, _alignment, _size))
+RT_AUDIT_WRAP(int,    pthread_mutex_lock,     (pthread_mutex_t* _mutex),                        (_mutex))
+RT_AUDIT_WRAP(int,    pthread_cond_wait,      (pthread_cond_t* _cond, pthread_mutex_t* _mutex), (_cond, _mutex))
+RT_AUDIT_WRAP(int,    pthread_cond_timedwait, (pthread_cond_t* _cond, pthread_mutex_t* _mutex, const struct timespec* _time),
+                                                                                                (_cond, _mutex, _time))
+#if __GLIBC_PREREQ(2, 30)
+RT_AUDIT_WRAP(int,    pthread_cond_clockwait, (pthread_cond_t* _cond, pthread_mutex_t* _mutex, clockid_t _clock, const struct timespec* _time),
+                                                                                                (_cond, _mutex, _clock, _time))
+#endif
+RT_AUDIT_WRAP(int,    nanosleep,              (const struct timespec* _time, struct timespec* _left), (_time, _left))
+RT_AUDIT_WRAP(int,    clock_nanosleep,        (clockid_t _clock, int _flags, const struct timespec* _time, struct timespec* _left),
+                                                                                                (_clock, _flags, _time, _left))
+RT_AUDIT_WRAP(ssize_t, write,                 (int _fd, const void* _buffer, size_t _size),     (_fd, _buffer, _size))
+RT_AUDIT_WRAP(FILE*,  fopen,                  (const char* _path, const char* _mode),           (_path, _mode))
+RT_AUDIT_WRAP(size_t, fwrite,                 (const void* _buffer, size_t _size, size_t _count, FILE* _file),
+                                                                                                (_buffer, _size, _count, _file))
+RT_AUDIT_WRAP(int,    fputs,                  (const char* _string, FILE* _file),               (_string, _file))
+
+// Freeing nothing is harmless:
+void __real_free(void* _ptr);
+void __wrap_free(void* _ptr) {
+  if (_ptr) {
+    Doofuzz_RTAudit::check("free");
+  }
+  __real_free(_ptr);
+}
+
+#undef RT_AUDIT_WRAP
+
+}
+
+// Each wrapped call, inside a scope, in a child process, which has to abort. Results
+// go to a volatile, so that the compiler can't elide the calls; waits lock with
+// trylock(), which isn't wrapped, so that it's the wait that gets caught:
+static bool checkWrappers() {
+
+  static void* volatile     memory  = nullptr;
+  static pthread_mutex_t    mutex   = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t     cond    = PTHREAD_COND_INITIALIZER;
+  static const timespec     past    = { 0, 0 };
+  static const timespec     nap     = { 0, 1 };
+
+  const std::pair<const char*, std::function<void()>> calls[] = {
+    { "malloc",                 [] { memory = std::malloc(16); } },
+    { "calloc",                 [] { memory = std::calloc(1, 16); } },
+    { "realloc",                [] { memory = std::realloc(memory, 32); } },  // Of nullptr, GCC makes it malloc()
+    { "free",                   [] { std::free(memory); } },
+    { "aligned_alloc",          [] { memory = aligned_alloc(64, 64); } },
+    { "posix_memalign",         [] { void* ptr; posix_memalign(&ptr, 64, 64); memory = ptr; } },
+    { "std::mutex",             [] { std::mutex m; m.lock(); m.unlock(); } },
+    { "pthread_cond_wait",      [] { pthread_mutex_trylock(&mutex); pthread_cond_wait(&cond, &mutex); } },
+    { "pthread_cond_timedwait", [] { pthread_mutex_trylock(&mutex); pthread_cond_timedwait(&cond, &mutex, &past); } },
+    { "condition_variable",     [] { std::mutex m; std::condition_variable cv; m.try_lock(); std::unique_lock<std::mutex> lock(m, std::adopt_lock);
+                                     cv.wait_for(lock, std::chrono::nanoseconds(1)); } },
+    { "nanosleep",              [] { nanosleep(&nap, nullptr); } },
+    { "sleep_for",              [] { std::this_thread::sleep_for(std::chrono::nanoseconds(1)); } },
+    { "write",                  [] { memory = (void*)write(-1, "", 0); } },
+    { "fopen",                  [] { memory = std::fopen("/dev/null", "w"); } },
+    { "SharedCache miss",       [] { memory = (void*)SharedCache<DoofuzzCoefs>::get(12345.0).get(); } },  // Locks
+  };
+
+  memory = std::malloc(16);  // For realloc() and free()
+
+  bool caught = true;
+
+  for (const auto& call: calls) {
+
+    std::fflush(stderr);
+    const pid_t child = fork();
+    if (child == 0) {
+      std::freopen("/dev/null", "w", stderr);  // The report is expected
+      {
+        RT_AUDIT_SCOPE;
+        call.second();
+      }
+      _exit(0);
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFSIGNALED(status) || (WTERMSIG(status) != SIGABRT)) {
+      std::fprintf(stderr, "The audit misses %s\n", call.first);
+      caught = false;
+    }
+  }
+
+  return caught;
+}
+
+static const double kRates[]        = { 22050.0, 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+static const int    kBlockSizes[]   = { 1, 17, 128, 512, 4096 };
+static const int    kLayouts[][2]   = { { 1, 1 }, { 1, 2 }, { 2, 2 }, { 6, 6 }, { 8, 8 }, { 12, 12 } };
+static const int    kNumAutomated   = 64;  // Blocks of random automation per configuration
+
+static bool checkOutput(HeadlessHost& _host,
+                        int           _nOutChans,
+                        int           _nFrames) {
+  for (int ch = 0; ch < _nOutChans; ch++) {
+    for (int f = 0; f < _nFrames; f++) {
+      if (!std::isfinite(double(_host.output(ch)[f]))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+
+  if (!checkWrappers()) {
+    return 1;
+  }
+
+  // Telemetry on, in a directory of its own, which is empty again once the publisher
+  // has removed the files of the instances gone (the latest at exit):
+  static char telemetryDir[] = "/tmp/doofuzz-rt-audit-XXXXXX";
+  if (mkdtemp(telemetryDir)) {
+    setenv("DOOFUZZ_TELEMETRY_DIR", telemetryDir, 1);
+    std::atexit([] { rmdir(telemetryDir); });
+  }
+
+  std::mt19937 random(39);
+  int          configs = 0;
+  long long    blocks  = 0;
+
+  for (const auto& layout: kLayouts) {
+    for (double rate: kRates) {
+      for (int blockSize: kBlockSizes) {
+
+        const bool    inPlace = ((configs % 2) == 1);
+        HeadlessHost  host(rate, blockSize, layout[0], layout[1], inPlace);
+        host.plugin().setEnvelopeAtBaseRate(((configs / 2) % 2) == 1);
+        host.reset();
+
+        auto run = [&](int _nFrames) {
+          host.process(_nFrames);
+          blocks++;
+          if (!checkOutput(host, layout[1], _nFrames)) {
+            std::fprintf(stderr, "Non-finite output at %.0f Hz, %d frames, %d-%d\n", rate, blockSize, layout[0], layout[1]);
+            std::exit(1);
+          }
+        };
+
+        // Every parameter from end to end, one step per block, with empty blocks in
+        // between, the way some hosts flush automation:
+        for (int p = 0; p < kNumParams; p++) {
+
+          IParam*       param = host.plugin().GetParam(p);
+          const double  steps = (p == kParamActive || p == kParamOversampling || p == kParamAutoOversampling) ? (param->GetMax() - param->GetMin()) : 4.0;
+
+          for (int sweep = 0; sweep < 2; sweep++) {
+            for (int s = 0; s <= int(steps); s++) {
+              const double x = (sweep == 0) ? s / steps : 1.0 - s / steps;
+              host.setParam(p, param->GetMin() + x * (param->GetMax() - param->GetMin()));
+              run(blockSize);
+              run(0);
+            }
+          }
+
+          host.setParam(p, param->GetDefault());
+        }
+
+        // Random automation, including oversampling mode changes mid-crossfade, and
+        // (as one more "parameter") switches of the envelope mode:
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        for (int b = 0; b < kNumAutomated; b++) {
+          const int     p     = int(random() % (kNumParams + 1));
+          if (p == kNumParams) {
+            host.plugin().setEnvelopeAtBaseRate((random() % 2) == 1);
+            run(blockSize);
+            continue;
+          }
+          IParam*       param = host.plugin().GetParam(p);
+          double        value = param->GetMin() + unit(random) * (param->GetMax() - param->GetMin());
+          if ((p == kParamActive) || (p == kParamOversampling) || (p == kParamAutoOversampling)) {
+            value = std::round(value);
+          }
+          host.setParam(p, value);
+          run((random() % 8 == 0) ? 0 : blockSize);
+        }
+
+        configs++;
+      }
+    }
+  }
+
+  std::printf("rt_audit_stress: %d configurations, %lld blocks, no violations\n", configs, blocks);
+  return 0;
+}